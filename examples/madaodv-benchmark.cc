@@ -0,0 +1,424 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ * Benchmark scenario for MADAODV route discovery.
+ */
+
+#include "ns3/applications-module.h"
+#include "ns3/core-module.h"
+#include "ns3/internet-module.h"
+#include "ns3/madaodv-module.h"
+#include "ns3/mobility-module.h"
+#include "ns3/network-module.h"
+#include "ns3/yans-wifi-helper.h"
+
+#include <iostream>
+
+using namespace ns3;
+
+/**
+ * \ingroup madaodv-examples
+ * \ingroup examples
+ * \brief Route discovery benchmark.
+ *
+ * This script places nodes on a rows x cols grid, optionally moving them with a random walk, and
+ * starts a number of constant bit rate UDP flows between random node pairs. A small grid step
+ * gives a dense network where RREQ floods dominate the control overhead. At the end it reports:
+ *
+ * - the control overhead: MADAODV packets and bytes sent by all nodes;
+ * - the discovery success: the fraction of flows which delivered at least one packet;
+ * - the packet delivery ratio of all flows;
+ * - the mean and maximum end-to-end delay, the latter showing the stalls after link breaks.
+ *
+ * Compare the RREQ suppression schemes with e.g.
+ *
+ * ./ns3 run "madaodv-benchmark --step=20 --suppression=Counter"
+ *
+ * and multipath failover against single path routing with e.g.
+ *
+ * ./ns3 run "madaodv-benchmark --speed=5 --multipath=1"
+ *
+ * Flows may also be spread over the alternate paths with --striping=1.
+ *
+ * Load-aware route discovery against plain hop count, with enough flows to congest the relays:
+ *
+ * ./ns3 run "madaodv-benchmark --flows=20 --rate=64kbps --loadAware=1"
+ */
+class MadaodvBenchmark
+{
+  public:
+    MadaodvBenchmark();
+    /**
+     * \brief Configure script parameters
+     * \param argc is the command line argument count
+     * \param argv is the command line arguments
+     * \return true on successful configuration
+     */
+    bool Configure(int argc, char** argv);
+    /// Run simulation
+    void Run();
+    /**
+     * Report results
+     * \param os the output stream
+     */
+    void Report(std::ostream& os);
+
+  private:
+    // parameters
+    /// Number of grid rows
+    uint32_t rows;
+    /// Number of grid columns
+    uint32_t cols;
+    /// Distance between nodes, meters
+    double step;
+    /// Node speed, m/s. Nodes are static if 0
+    double speed;
+    /// Number of flows
+    uint32_t flows;
+    /// Data rate of each flow
+    std::string rate;
+    /// Size of the data packets, bytes
+    uint32_t packetSize;
+    /// Simulation time, seconds
+    double totalTime;
+    /// RREQ suppression scheme
+    std::string suppression;
+    /// Keep alternate paths if true
+    bool multipath;
+    /// Spread flows over the alternate paths if true
+    bool striping;
+    /// Select the reverse routes by the load of their relays if true
+    bool loadAware;
+
+    // network
+    /// nodes used in the example
+    NodeContainer nodes;
+    /// devices used in the example
+    NetDeviceContainer devices;
+    /// interfaces used in the example
+    Ipv4InterfaceContainer interfaces;
+    /// packet sinks, one per flow
+    ApplicationContainer sinks;
+
+    // statistics
+    /// Number of MADAODV packets sent
+    uint64_t controlPackets;
+    /// Number of MADAODV bytes sent, IP header included
+    uint64_t controlBytes;
+    /// Number of data packets sent by the sources
+    uint64_t dataSent;
+    /// Sum of the end-to-end delays of the received data packets
+    Time delaySum;
+    /// Maximum end-to-end delay of the received data packets
+    Time delayMax;
+
+  private:
+    /// Create the nodes
+    void CreateNodes();
+    /// Create the devices
+    void CreateDevices();
+    /// Create the network
+    void InstallInternetStack();
+    /// Create the simulation applications
+    void InstallApplications();
+    /**
+     * Count MADAODV packets leaving the IP layer
+     * \param packet the packet, IP header included
+     * \param ipv4 the IP layer
+     * \param interface the output interface
+     */
+    void IpTx(Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface);
+    /**
+     * Count data packets sent by the sources
+     * \param packet the packet
+     */
+    void DataTx(Ptr<const Packet> packet);
+    /**
+     * Measure the delay of data packets received by the sinks
+     * \param packet the packet
+     * \param from the source address
+     * \param to the destination address
+     * \param header the sequence number, timestamp and size header
+     */
+    void DataRx(Ptr<const Packet> packet,
+                const Address& from,
+                const Address& to,
+                const SeqTsSizeHeader& header);
+};
+
+int
+main(int argc, char** argv)
+{
+    MadaodvBenchmark test;
+    if (!test.Configure(argc, argv))
+    {
+        NS_FATAL_ERROR("Configuration failed. Aborted.");
+    }
+
+    test.Run();
+    test.Report(std::cout);
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+MadaodvBenchmark::MadaodvBenchmark()
+    : rows(7),
+      cols(7),
+      step(40),
+      speed(0),
+      flows(10),
+      rate("8kbps"),
+      packetSize(512),
+      totalTime(60),
+      suppression("None"),
+      multipath(false),
+      striping(false),
+      loadAware(false),
+      controlPackets(0),
+      controlBytes(0),
+      dataSent(0),
+      delaySum(0),
+      delayMax(0)
+{
+}
+
+bool
+MadaodvBenchmark::Configure(int argc, char** argv)
+{
+    SeedManager::SetSeed(12345);
+    CommandLine cmd(__FILE__);
+
+    cmd.AddValue("rows", "Number of grid rows.", rows);
+    cmd.AddValue("cols", "Number of grid columns.", cols);
+    cmd.AddValue("step", "Grid step, m", step);
+    cmd.AddValue("speed", "Random walk speed, m/s. Nodes are static if 0.", speed);
+    cmd.AddValue("flows", "Number of UDP flows between random node pairs.", flows);
+    cmd.AddValue("rate", "Data rate of each flow.", rate);
+    cmd.AddValue("packetSize", "Size of the data packets, bytes.", packetSize);
+    cmd.AddValue("time", "Simulation time, s.", totalTime);
+    cmd.AddValue("suppression",
+                 "RREQ suppression scheme: None, Counter, Gossip or Coverage.",
+                 suppression);
+    cmd.AddValue("multipath", "Keep alternate paths for fast failover.", multipath);
+    cmd.AddValue("striping", "Spread flows over the alternate paths.", striping);
+    cmd.AddValue("loadAware", "Avoid the relays with long queues in route discovery.", loadAware);
+
+    cmd.Parse(argc, argv);
+    return rows * cols >= 2;
+}
+
+void
+MadaodvBenchmark::Run()
+{
+    CreateNodes();
+    CreateDevices();
+    InstallInternetStack();
+    InstallApplications();
+
+    std::cout << "Starting simulation for " << totalTime << " s ...\n";
+
+    Simulator::Stop(Seconds(totalTime));
+    Simulator::Run();
+}
+
+void
+MadaodvBenchmark::Report(std::ostream& os)
+{
+    uint64_t dataReceived = 0;
+    uint32_t discovered = 0;
+    for (uint32_t i = 0; i < sinks.GetN(); ++i)
+    {
+        Ptr<PacketSink> sink = DynamicCast<PacketSink>(sinks.Get(i));
+        dataReceived += sink->GetTotalRx();
+        if (sink->GetTotalRx() > 0)
+        {
+            discovered++;
+        }
+    }
+    // Sinks count bytes, all data packets have the same size
+    dataReceived /= packetSize;
+
+    os << "RREQ suppression: " << suppression << "\n"
+       << "Multipath: " << (multipath ? "on" : "off") << "\n"
+       << "Striping: " << (striping ? "on" : "off") << "\n"
+       << "Load-aware discovery: " << (loadAware ? "on" : "off") << "\n"
+       << "Control packets sent: " << controlPackets << "\n"
+       << "Control bytes sent: " << controlBytes << "\n"
+       << "Discovery success: " << discovered << "/" << sinks.GetN() << "\n"
+       << "Data packets sent: " << dataSent << "\n"
+       << "Data packets received: " << dataReceived << "\n";
+    if (dataSent > 0)
+    {
+        os << "Packet delivery ratio: " << double(dataReceived) / dataSent << "\n";
+    }
+    if (dataReceived > 0)
+    {
+        os << "Control packets per delivered packet: " << double(controlPackets) / dataReceived
+           << "\n"
+           << "Mean delay: " << (delaySum / dataReceived).As(Time::MS) << "\n"
+           << "Max delay: " << delayMax.As(Time::MS) << "\n"
+           << "Throughput: " << dataReceived * packetSize * 8 / totalTime / 1000 << " kbps\n";
+    }
+
+    Simulator::Destroy();
+}
+
+void
+MadaodvBenchmark::CreateNodes()
+{
+    std::cout << "Creating " << rows << "x" << cols << " grid, " << step << " m apart.\n";
+    nodes.Create(rows * cols);
+    MobilityHelper mobility;
+    mobility.SetPositionAllocator("ns3::GridPositionAllocator",
+                                  "MinX",
+                                  DoubleValue(0.0),
+                                  "MinY",
+                                  DoubleValue(0.0),
+                                  "DeltaX",
+                                  DoubleValue(step),
+                                  "DeltaY",
+                                  DoubleValue(step),
+                                  "GridWidth",
+                                  UintegerValue(cols),
+                                  "LayoutType",
+                                  StringValue("RowFirst"));
+    if (speed > 0)
+    {
+        std::ostringstream os;
+        os << "ns3::ConstantRandomVariable[Constant=" << speed << "]";
+        Rectangle bounds(0, (cols - 1) * step, 0, (rows - 1) * step);
+        mobility.SetMobilityModel("ns3::RandomWalk2dMobilityModel",
+                                  "Bounds",
+                                  RectangleValue(bounds),
+                                  "Speed",
+                                  StringValue(os.str()));
+    }
+    else
+    {
+        mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    }
+    mobility.Install(nodes);
+}
+
+void
+MadaodvBenchmark::CreateDevices()
+{
+    WifiMacHelper wifiMac;
+    wifiMac.SetType("ns3::AdhocWifiMac");
+    YansWifiPhyHelper wifiPhy;
+    YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default();
+    wifiPhy.SetChannel(wifiChannel.Create());
+    WifiHelper wifi;
+    wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+                                 "DataMode",
+                                 StringValue("OfdmRate6Mbps"),
+                                 "RtsCtsThreshold",
+                                 UintegerValue(0));
+    devices = wifi.Install(wifiPhy, wifiMac, nodes);
+}
+
+void
+MadaodvBenchmark::InstallInternetStack()
+{
+    MadaodvHelper madaodv;
+    madaodv.Set("RreqSuppression", StringValue(suppression));
+    madaodv.Set("EnableMultipath", BooleanValue(multipath || striping));
+    madaodv.Set("EnableStriping", BooleanValue(striping));
+    if (loadAware)
+    {
+        madaodv.Set("EnableLoadAwareness", BooleanValue(true));
+        madaodv.Set("RreqHoldTime", TimeValue(MilliSeconds(20)));
+    }
+    InternetStackHelper stack;
+    stack.SetRoutingHelper(madaodv); // has effect on the next Install ()
+    stack.Install(nodes);
+    Ipv4AddressHelper address;
+    address.SetBase("10.0.0.0", "255.0.0.0");
+    interfaces = address.Assign(devices);
+
+    Config::ConnectWithoutContext("/NodeList/*/$ns3::Ipv4L3Protocol/Tx",
+                                  MakeCallback(&MadaodvBenchmark::IpTx, this));
+}
+
+void
+MadaodvBenchmark::InstallApplications()
+{
+    Ptr<UniformRandomVariable> node = CreateObject<UniformRandomVariable>();
+    Ptr<UniformRandomVariable> start = CreateObject<UniformRandomVariable>();
+    for (uint32_t i = 0; i < flows; ++i)
+    {
+        uint32_t src = node->GetInteger(0, nodes.GetN() - 1);
+        uint32_t dst = node->GetInteger(0, nodes.GetN() - 2);
+        if (dst >= src)
+        {
+            dst++;
+        }
+        uint16_t port = 9 + i;
+
+        PacketSinkHelper sink("ns3::UdpSocketFactory",
+                              InetSocketAddress(Ipv4Address::GetAny(), port));
+        sink.SetAttribute("EnableSeqTsSizeHeader", BooleanValue(true));
+        ApplicationContainer sinkApp = sink.Install(nodes.Get(dst));
+        sinkApp.Get(0)->TraceConnectWithoutContext("RxWithSeqTsSize",
+                                                   MakeCallback(&MadaodvBenchmark::DataRx, this));
+        sinks.Add(sinkApp);
+
+        OnOffHelper onOff("ns3::UdpSocketFactory",
+                          InetSocketAddress(interfaces.GetAddress(dst), port));
+        onOff.SetConstantRate(DataRate(rate), packetSize);
+        onOff.SetAttribute("EnableSeqTsSizeHeader", BooleanValue(true));
+        ApplicationContainer source = onOff.Install(nodes.Get(src));
+        source.Start(Seconds(start->GetValue(1, 5)));
+        source.Stop(Seconds(totalTime - 1));
+        source.Get(0)->TraceConnectWithoutContext("Tx",
+                                                  MakeCallback(&MadaodvBenchmark::DataTx, this));
+    }
+    sinks.Start(Seconds(0));
+}
+
+void
+MadaodvBenchmark::IpTx(Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+    Ptr<Packet> p = packet->Copy();
+    Ipv4Header ipHeader;
+    p->RemoveHeader(ipHeader);
+    if (ipHeader.GetProtocol() != UdpL4Protocol::PROT_NUMBER)
+    {
+        return;
+    }
+    UdpHeader udpHeader;
+    p->PeekHeader(udpHeader);
+    if (udpHeader.GetDestinationPort() == madaodv::RoutingProtocol::MADAODV_PORT)
+    {
+        controlPackets++;
+        controlBytes += packet->GetSize();
+    }
+}
+
+void
+MadaodvBenchmark::DataTx(Ptr<const Packet> packet)
+{
+    dataSent++;
+}
+
+void
+MadaodvBenchmark::DataRx(Ptr<const Packet> packet,
+                         const Address& from,
+                         const Address& to,
+                         const SeqTsSizeHeader& header)
+{
+    Time delay = Simulator::Now() - header.GetTs();
+    delaySum += delay;
+    delayMax = std::max(delayMax, delay);
+}
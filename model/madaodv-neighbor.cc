@@ -40,7 +40,11 @@ NS_LOG_COMPONENT_DEFINE("MadaodvNeighbors");
 namespace madaodv
 {
 Neighbors::Neighbors(Time delay)
-    : m_ntimer(Timer::CANCEL_ON_DESTROY)
+    : m_retryThreshold(3),
+      m_rssiThreshold(-90),
+      m_ntimer(Timer::CANCEL_ON_DESTROY),
+      m_meanLinkLifetime(Seconds(0)),
+      m_linkLifetimeWeight(0.25)
 {
     m_ntimer.SetDelay(delay);
     m_ntimer.SetFunction(&Neighbors::Purge, this);
@@ -61,6 +65,39 @@ Neighbors::IsNeighbor(Ipv4Address addr)
     return false;
 }
 
+void
+Neighbors::GetNeighbors(std::vector<Ipv4Address>& addrs)
+{
+    Purge();
+    addrs.clear();
+    addrs.reserve(m_nb.size());
+    for (std::vector<Neighbor>::const_iterator i = m_nb.begin(); i != m_nb.end(); ++i)
+    {
+        addrs.push_back(i->m_neighborAddress);
+    }
+}
+
+uint32_t
+Neighbors::GetNeighborCount()
+{
+    Purge();
+    return m_nb.size();
+}
+
+bool
+Neighbors::GetRssi(Ipv4Address addr, double& rssi) const
+{
+    for (std::vector<Neighbor>::const_iterator i = m_nb.begin(); i != m_nb.end(); ++i)
+    {
+        if (i->m_neighborAddress == addr)
+        {
+            rssi = i->m_rssi;
+            return i->m_rssiValid;
+        }
+    }
+    return false;
+}
+
 Time
 Neighbors::GetExpireTime(Ipv4Address addr)
 {
@@ -75,6 +112,51 @@ Neighbors::GetExpireTime(Ipv4Address addr)
     return Seconds(0);
 }
 
+Time
+Neighbors::GetLinkLifetime(Ipv4Address addr)
+{
+    Purge();
+    std::map<Ipv4Address, Time>::const_iterator l = m_linkLifetime.find(addr);
+    Time estimate = (l != m_linkLifetime.end()) ? l->second : m_meanLinkLifetime;
+    if (estimate.IsZero())
+    {
+        return estimate;
+    }
+    for (std::vector<Neighbor>::const_iterator i = m_nb.begin(); i != m_nb.end(); ++i)
+    {
+        if (i->m_neighborAddress == addr)
+        {
+            return std::max(estimate, Simulator::Now() - i->m_upTime);
+        }
+    }
+    return estimate;
+}
+
+void
+Neighbors::RecordLinkLifetime(const Neighbor& nb)
+{
+    Time lifetime = nb.m_lastSeen - nb.m_upTime;
+    bool first = m_linkLifetime.empty();
+    std::pair<std::map<Ipv4Address, Time>::iterator, bool> result =
+        m_linkLifetime.insert(std::make_pair(nb.m_neighborAddress, lifetime));
+    if (!result.second)
+    {
+        result.first->second = Time(m_linkLifetimeWeight * lifetime.GetDouble() +
+                                    (1 - m_linkLifetimeWeight) * result.first->second.GetDouble());
+    }
+    if (first)
+    {
+        m_meanLinkLifetime = lifetime;
+    }
+    else
+    {
+        m_meanLinkLifetime = Time(m_linkLifetimeWeight * lifetime.GetDouble() +
+                                  (1 - m_linkLifetimeWeight) * m_meanLinkLifetime.GetDouble());
+    }
+    NS_LOG_LOGIC("Link to " << nb.m_neighborAddress << " lasted " << lifetime.As(Time::S)
+                            << ", average " << result.first->second.As(Time::S));
+}
+
 void
 Neighbors::Update(Ipv4Address addr, Time expire)
 {
@@ -83,6 +165,7 @@ Neighbors::Update(Ipv4Address addr, Time expire)
         if (i->m_neighborAddress == addr)
         {
             i->m_expireTime = std::max(expire + Simulator::Now(), i->m_expireTime);
+            i->m_lastSeen = Simulator::Now();
             if (i->m_hardwareAddress == Mac48Address())
             {
                 i->m_hardwareAddress = LookupMacAddress(i->m_neighborAddress);
@@ -95,6 +178,10 @@ Neighbors::Update(Ipv4Address addr, Time expire)
     Neighbor neighbor(addr, LookupMacAddress(addr), expire + Simulator::Now());
     m_nb.push_back(neighbor);
     Purge();
+    if (!m_handleNeighborChange.IsNull())
+    {
+        m_handleNeighborChange();
+    }
 }
 
 /**
@@ -123,18 +210,24 @@ Neighbors::Purge()
     }
 
     CloseNeighbor pred;
-    if (!m_handleLinkFailure.IsNull())
+    for (std::vector<Neighbor>::iterator j = m_nb.begin(); j != m_nb.end(); ++j)
     {
-        for (std::vector<Neighbor>::iterator j = m_nb.begin(); j != m_nb.end(); ++j)
+        if (pred(*j))
         {
-            if (pred(*j))
+            NS_LOG_LOGIC("Close link to " << j->m_neighborAddress);
+            RecordLinkLifetime(*j);
+            if (!m_handleLinkFailure.IsNull())
             {
-                NS_LOG_LOGIC("Close link to " << j->m_neighborAddress);
                 m_handleLinkFailure(j->m_neighborAddress);
             }
         }
     }
+    std::size_t size = m_nb.size();
     m_nb.erase(std::remove_if(m_nb.begin(), m_nb.end(), pred), m_nb.end());
+    if (m_nb.size() != size && !m_handleNeighborChange.IsNull())
+    {
+        m_handleNeighborChange();
+    }
     m_ntimer.Cancel();
     m_ntimer.Schedule();
 }
@@ -174,6 +267,136 @@ Neighbors::LookupMacAddress(Ipv4Address addr)
     return hwaddr;
 }
 
+void
+Neighbors::SetSymmetric(Ipv4Address addr, bool symmetric)
+{
+    for (std::vector<Neighbor>::iterator i = m_nb.begin(); i != m_nb.end(); ++i)
+    {
+        if (i->m_neighborAddress == addr)
+        {
+            i->m_symmetryKnown = true;
+            i->m_symmetric = symmetric;
+            return;
+        }
+    }
+}
+
+bool
+Neighbors::IsUnidirectional(Ipv4Address addr)
+{
+    Purge();
+    for (std::vector<Neighbor>::const_iterator i = m_nb.begin(); i != m_nb.end(); ++i)
+    {
+        if (i->m_neighborAddress == addr)
+        {
+            return i->m_symmetryKnown && !i->m_symmetric;
+        }
+    }
+    return false;
+}
+
+bool
+Neighbors::IsSymmetric(Ipv4Address addr)
+{
+    Purge();
+    for (std::vector<Neighbor>::const_iterator i = m_nb.begin(); i != m_nb.end(); ++i)
+    {
+        if (i->m_neighborAddress == addr)
+        {
+            return i->m_symmetryKnown && i->m_symmetric;
+        }
+    }
+    return false;
+}
+
+bool
+Neighbors::IsLinkWeak(Ipv4Address addr) const
+{
+    for (std::vector<Neighbor>::const_iterator i = m_nb.begin(); i != m_nb.end(); ++i)
+    {
+        if (i->m_neighborAddress == addr)
+        {
+            return i->m_weak;
+        }
+    }
+    return false;
+}
+
+void
+Neighbors::ProcessTxRetry(Mac48Address addr)
+{
+    for (std::vector<Neighbor>::iterator i = m_nb.begin(); i != m_nb.end(); ++i)
+    {
+        if (i->m_hardwareAddress == addr)
+        {
+            i->m_txFailures++;
+            CheckLinkWeak(*i);
+            return;
+        }
+    }
+}
+
+void
+Neighbors::ProcessTxSuccess(Mac48Address addr)
+{
+    for (std::vector<Neighbor>::iterator i = m_nb.begin(); i != m_nb.end(); ++i)
+    {
+        if (i->m_hardwareAddress == addr)
+        {
+            i->m_txFailures = 0;
+            CheckLinkWeak(*i);
+            return;
+        }
+    }
+}
+
+void
+Neighbors::ProcessRxSignal(Mac48Address addr, double rssi)
+{
+    // Weight of the newest frame in the smoothed signal strength and its trend
+    const double weight = 0.25;
+    for (std::vector<Neighbor>::iterator i = m_nb.begin(); i != m_nb.end(); ++i)
+    {
+        if (i->m_hardwareAddress == addr)
+        {
+            if (!i->m_rssiValid)
+            {
+                i->m_rssi = rssi;
+                i->m_rssiValid = true;
+            }
+            else
+            {
+                double smoothed = weight * rssi + (1 - weight) * i->m_rssi;
+                i->m_rssiTrend = weight * (smoothed - i->m_rssi) + (1 - weight) * i->m_rssiTrend;
+                i->m_rssi = smoothed;
+            }
+            CheckLinkWeak(*i);
+            return;
+        }
+    }
+}
+
+void
+Neighbors::CheckLinkWeak(Neighbor& nb)
+{
+    bool weak = (m_retryThreshold > 0 && nb.m_txFailures >= m_retryThreshold) ||
+                (nb.m_rssiValid && nb.m_rssi < m_rssiThreshold && nb.m_rssiTrend < 0);
+    if (weak == nb.m_weak)
+    {
+        return;
+    }
+    nb.m_weak = weak;
+    if (weak)
+    {
+        NS_LOG_LOGIC("Link to " << nb.m_neighborAddress << " is going to fail, "
+                                << nb.m_txFailures << " failures, " << nb.m_rssi << " dBm");
+        if (!m_handleLinkWeak.IsNull())
+        {
+            m_handleLinkWeak(nb.m_neighborAddress);
+        }
+    }
+}
+
 void
 Neighbors::ProcessTxError(const WifiMacHeader& hdr)
 {
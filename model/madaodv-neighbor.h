@@ -34,6 +34,7 @@
 #include "ns3/simulator.h"
 #include "ns3/timer.h"
 
+#include <map>
 #include <vector>
 
 namespace ns3
@@ -70,6 +71,24 @@ class Neighbors
         Time m_expireTime;
         /// Neighbor close indicator
         bool close;
+        /// Time the link to the neighbor was opened
+        Time m_upTime;
+        /// Time the neighbor was last heard
+        Time m_lastSeen;
+        /// Number of consecutive MAC transmission failures towards the neighbor
+        uint32_t m_txFailures;
+        /// Smoothed received signal strength of the neighbor, in dBm
+        double m_rssi;
+        /// Smoothed change of the received signal strength per frame, in dB
+        double m_rssiTrend;
+        /// Indicates whether m_rssi holds a sample
+        bool m_rssiValid;
+        /// Indicates whether the link was predicted to fail
+        bool m_weak;
+        /// Indicates whether the neighbor told whether it hears this node
+        bool m_symmetryKnown;
+        /// Indicates whether the neighbor hears this node
+        bool m_symmetric;
 
         /**
          * \brief Neighbor structure constructor
@@ -82,7 +101,16 @@ class Neighbors
             : m_neighborAddress(ip),
               m_hardwareAddress(mac),
               m_expireTime(t),
-              close(false)
+              close(false),
+              m_upTime(Simulator::Now()),
+              m_lastSeen(Simulator::Now()),
+              m_txFailures(0),
+              m_rssi(0),
+              m_rssiTrend(0),
+              m_rssiValid(false),
+              m_weak(false),
+              m_symmetryKnown(false),
+              m_symmetric(false)
         {
         }
     };
@@ -99,6 +127,116 @@ class Neighbors
      * \returns true if the node with IP address is a neighbor
      */
     bool IsNeighbor(Ipv4Address addr);
+    /**
+     * Get the addresses of all neighbors which have not expired
+     * \param addrs the list of neighbor addresses to fill
+     */
+    void GetNeighbors(std::vector<Ipv4Address>& addrs);
+    /**
+     * Count the neighbors which have not expired
+     * \returns the number of neighbors
+     */
+    uint32_t GetNeighborCount();
+    /**
+     * Get the smoothed signal strength of a neighbor
+     * \param addr the IP address of the neighbor node
+     * \param rssi the smoothed received signal strength in dBm, if known
+     * \returns true if a signal strength sample of the neighbor was received
+     */
+    bool GetRssi(Ipv4Address addr, double& rssi) const;
+    /**
+     * Estimate how long the link to a neighbor is going to last.
+     *
+     * The estimate is the moving average of the lifetimes of past links to this neighbor, or of
+     * past links to any neighbor if none was recorded for it. A link which is up and has already
+     * outlived the average is credited with its current age.
+     *
+     * \param addr the IP address of the neighbor node
+     * \returns the estimated link lifetime, zero if no link lifetime was recorded yet
+     */
+    Time GetLinkLifetime(Ipv4Address addr);
+
+    /**
+     * Set the weight of a new sample in the link lifetime moving averages
+     * \param weight the weight, in (0, 1]
+     */
+    void SetLinkLifetimeWeight(double weight)
+    {
+        m_linkLifetimeWeight = weight;
+    }
+
+    /**
+     * Get the weight of a new sample in the link lifetime moving averages
+     * \returns the weight
+     */
+    double GetLinkLifetimeWeight() const
+    {
+        return m_linkLifetimeWeight;
+    }
+
+    /**
+     * Record whether a neighbor hears this node, as advertised in its HELLO
+     * \param addr the IP address of the neighbor node
+     * \param symmetric true if the neighbor hears this node
+     */
+    void SetSymmetric(Ipv4Address addr, bool symmetric);
+    /**
+     * Check whether a neighbor advertised that it does not hear this node
+     * \param addr the IP address of the neighbor node
+     * \returns true if the link to the neighbor is known to be unidirectional
+     */
+    bool IsUnidirectional(Ipv4Address addr);
+    /**
+     * Check whether a neighbor advertised that it hears this node
+     * \param addr the IP address of the neighbor node
+     * \returns true if the link to the neighbor is known to be bidirectional
+     */
+    bool IsSymmetric(Ipv4Address addr);
+
+    /**
+     * Set the thresholds above which a link is predicted to fail
+     * \param retryThreshold number of consecutive MAC transmission failures
+     * \param rssiThreshold smoothed signal strength in dBm, a link below it whose signal keeps
+     *        fading is predicted to fail
+     */
+    void SetLinkPrediction(uint32_t retryThreshold, double rssiThreshold)
+    {
+        m_retryThreshold = retryThreshold;
+        m_rssiThreshold = rssiThreshold;
+    }
+
+    /**
+     * Set the callback invoked when a link is predicted to fail
+     * \param cb the callback function
+     */
+    void SetLinkWeakCallback(Callback<void, Ipv4Address> cb)
+    {
+        m_handleLinkWeak = cb;
+    }
+
+    /**
+     * Check whether the link to a neighbor is predicted to fail
+     * \param addr the IP address of the neighbor node
+     * \returns true if the link is weak
+     */
+    bool IsLinkWeak(Ipv4Address addr) const;
+    /**
+     * Process a failed MAC transmission attempt
+     * \param addr the MAC address of the receiver
+     */
+    void ProcessTxRetry(Mac48Address addr);
+    /**
+     * Process an acknowledged MAC transmission
+     * \param addr the MAC address of the receiver
+     */
+    void ProcessTxSuccess(Mac48Address addr);
+    /**
+     * Process the signal strength of a frame received from a neighbor
+     * \param addr the MAC address of the transmitter
+     * \param rssi the received signal strength in dBm
+     */
+    void ProcessRxSignal(Mac48Address addr, double rssi);
+
     /**
      * Update expire time for entry with address addr, if it exists, else add new entry
      * \param addr the IP address to check
@@ -154,9 +292,26 @@ class Neighbors
         return m_handleLinkFailure;
     }
 
+    /**
+     * Set the callback invoked when a neighbor appears or disappears
+     * \param cb the callback function
+     */
+    void SetNeighborChangeCallback(Callback<void> cb)
+    {
+        m_handleNeighborChange = cb;
+    }
+
   private:
     /// link failure callback
     Callback<void, Ipv4Address> m_handleLinkFailure;
+    /// link failure prediction callback
+    Callback<void, Ipv4Address> m_handleLinkWeak;
+    /// consecutive MAC transmission failures predicting a link failure
+    uint32_t m_retryThreshold;
+    /// signal strength in dBm below which a fading link is predicted to fail
+    double m_rssiThreshold;
+    /// neighbor set change callback
+    Callback<void> m_handleNeighborChange;
     /// TX error callback
     Callback<void, const WifiMacHeader&> m_txErrorCallback;
     /// Timer for neighbor's list. Schedule Purge().
@@ -165,6 +320,23 @@ class Neighbors
     std::vector<Neighbor> m_nb;
     /// list of ARP cached to be used for layer 2 notifications processing
     std::vector<Ptr<ArpCache>> m_arp;
+    /// moving average of the lifetime of closed links per neighbor
+    std::map<Ipv4Address, Time> m_linkLifetime;
+    /// moving average of the lifetime of all closed links
+    Time m_meanLinkLifetime;
+    /// weight of a new sample in the link lifetime moving averages
+    double m_linkLifetimeWeight;
+
+    /**
+     * Fold the lifetime of a closed link into the moving averages
+     * \param nb the neighbor entry being removed
+     */
+    void RecordLinkLifetime(const Neighbor& nb);
+    /**
+     * Update the failure prediction of a link and notify a newly weak link
+     * \param nb the neighbor entry
+     */
+    void CheckLinkWeak(Neighbor& nb);
 
     /**
      * Find MAC address by IP using list of ARP caches
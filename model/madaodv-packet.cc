@@ -27,8 +27,11 @@
 #include "madaodv-packet.h"
 
 #include "ns3/address-utils.h"
+#include "ns3/hash.h"
 #include "ns3/packet.h"
 
+#include <algorithm>
+
 namespace ns3
 {
 namespace madaodv
@@ -554,11 +557,13 @@ RerrHeader::Serialize(Buffer::Iterator i) const
     i.WriteU8(m_flag);
     i.WriteU8(m_reserved);
     i.WriteU8(GetDestCount());
-    std::map<Ipv4Address, uint32_t>::const_iterator j;
-    for (j = m_unreachableDstSeqNo.begin(); j != m_unreachableDstSeqNo.end(); ++j)
+    for (std::vector<std::pair<Ipv4Address, uint32_t>>::const_iterator j =
+             m_unreachableDstSeqNo.begin();
+         j != m_unreachableDstSeqNo.end();
+         ++j)
     {
-        WriteTo(i, (*j).first);
-        i.WriteHtonU32((*j).second);
+        WriteTo(i, j->first);
+        i.WriteHtonU32(j->second);
     }
 }
 
@@ -569,18 +574,37 @@ RerrHeader::Deserialize(Buffer::Iterator start)
     m_flag = i.ReadU8();
     m_reserved = i.ReadU8();
     uint8_t dest = i.ReadU8();
-    m_unreachableDstSeqNo.clear();
-    Ipv4Address address;
-    uint32_t seqNo;
+    m_unreachableDstSeqNo.resize(dest);
+    bool sorted = true;
     for (uint8_t k = 0; k < dest; ++k)
     {
-        ReadFrom(i, address);
-        seqNo = i.ReadNtohU32();
-        m_unreachableDstSeqNo.insert(std::make_pair(address, seqNo));
+        ReadFrom(i, m_unreachableDstSeqNo[k].first);
+        m_unreachableDstSeqNo[k].second = i.ReadNtohU32();
+        if (k > 0 && !(m_unreachableDstSeqNo[k - 1].first < m_unreachableDstSeqNo[k].first))
+        {
+            sorted = false;
+        }
+    }
+    // Our own RERRs are sorted, only foreign ones need to be sorted and cleared of duplicates
+    if (!sorted)
+    {
+        std::stable_sort(m_unreachableDstSeqNo.begin(),
+                         m_unreachableDstSeqNo.end(),
+                         [](const std::pair<Ipv4Address, uint32_t>& a,
+                            const std::pair<Ipv4Address, uint32_t>& b) {
+                             return a.first < b.first;
+                         });
+        m_unreachableDstSeqNo.erase(std::unique(m_unreachableDstSeqNo.begin(),
+                                                m_unreachableDstSeqNo.end(),
+                                                [](const std::pair<Ipv4Address, uint32_t>& a,
+                                                   const std::pair<Ipv4Address, uint32_t>& b) {
+                                                    return a.first == b.first;
+                                                }),
+                                    m_unreachableDstSeqNo.end());
     }
 
     uint32_t dist = i.GetDistanceFrom(start);
-    NS_ASSERT(dist == GetSerializedSize());
+    NS_ASSERT(dist == 3 + 8 * static_cast<uint32_t>(dest));
     return dist;
 }
 
@@ -588,7 +612,7 @@ void
 RerrHeader::Print(std::ostream& os) const
 {
     os << "Unreachable destination (ipv4 address, seq. number):";
-    std::map<Ipv4Address, uint32_t>::const_iterator j;
+    std::vector<std::pair<Ipv4Address, uint32_t>>::const_iterator j;
     for (j = m_unreachableDstSeqNo.begin(); j != m_unreachableDstSeqNo.end(); ++j)
     {
         os << (*j).first << ", " << (*j).second;
@@ -618,13 +642,24 @@ RerrHeader::GetNoDelete() const
 bool
 RerrHeader::AddUnDestination(Ipv4Address dst, uint32_t seqNo)
 {
-    if (m_unreachableDstSeqNo.find(dst) != m_unreachableDstSeqNo.end())
+    std::vector<std::pair<Ipv4Address, uint32_t>>::iterator i = m_unreachableDstSeqNo.end();
+    // Callers usually add destinations in ascending order, only search when they do not
+    if (!m_unreachableDstSeqNo.empty() && !(m_unreachableDstSeqNo.back().first < dst))
     {
-        return true;
+        i = std::lower_bound(m_unreachableDstSeqNo.begin(),
+                             m_unreachableDstSeqNo.end(),
+                             dst,
+                             [](const std::pair<Ipv4Address, uint32_t>& a, Ipv4Address b) {
+                                 return a.first < b;
+                             });
+        if (i->first == dst)
+        {
+            return true;
+        }
     }
 
     NS_ASSERT(GetDestCount() < 255); // can't support more than 255 destinations in single RERR
-    m_unreachableDstSeqNo.insert(std::make_pair(dst, seqNo));
+    m_unreachableDstSeqNo.insert(i, std::make_pair(dst, seqNo));
     return true;
 }
 
@@ -635,9 +670,8 @@ RerrHeader::RemoveUnDestination(std::pair<Ipv4Address, uint32_t>& un)
     {
         return false;
     }
-    std::map<Ipv4Address, uint32_t>::iterator i = m_unreachableDstSeqNo.begin();
-    un = *i;
-    m_unreachableDstSeqNo.erase(i);
+    un = m_unreachableDstSeqNo.back();
+    m_unreachableDstSeqNo.pop_back();
     return true;
 }
 
@@ -657,26 +691,653 @@ RerrHeader::operator==(const RerrHeader& o) const
         return false;
     }
 
-    std::map<Ipv4Address, uint32_t>::const_iterator j = m_unreachableDstSeqNo.begin();
-    std::map<Ipv4Address, uint32_t>::const_iterator k = o.m_unreachableDstSeqNo.begin();
-    for (uint8_t i = 0; i < GetDestCount(); ++i)
+    return m_unreachableDstSeqNo == o.m_unreachableDstSeqNo;
+}
+
+std::ostream&
+operator<<(std::ostream& os, const RerrHeader& h)
+{
+    h.Print(os);
+    return os;
+}
+//-----------------------------------------------------------------------------
+// Extensions
+//-----------------------------------------------------------------------------
+ExtensionHeader::ExtensionHeader(uint8_t type, uint8_t length)
+    : m_type(type),
+      m_length(length)
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED(ExtensionHeader);
+
+TypeId
+ExtensionHeader::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::madaodv::ExtensionHeader")
+                            .SetParent<Header>()
+                            .SetGroupName("Madaodv")
+                            .AddConstructor<ExtensionHeader>();
+    return tid;
+}
+
+TypeId
+ExtensionHeader::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+ExtensionHeader::GetSerializedSize() const
+{
+    return 2;
+}
+
+void
+ExtensionHeader::Serialize(Buffer::Iterator i) const
+{
+    i.WriteU8(m_type);
+    i.WriteU8(m_length);
+}
+
+uint32_t
+ExtensionHeader::Deserialize(Buffer::Iterator start)
+{
+    Buffer::Iterator i = start;
+    m_type = i.ReadU8();
+    m_length = i.ReadU8();
+    uint32_t dist = i.GetDistanceFrom(start);
+    NS_ASSERT(dist == GetSerializedSize());
+    return dist;
+}
+
+void
+ExtensionHeader::Print(std::ostream& os) const
+{
+    os << "extension type " << (uint16_t)m_type << " length " << (uint16_t)m_length;
+}
+
+/// Number of hash functions of the neighbor set Bloom filter
+static const uint32_t NEIGHBOR_SET_HASHES = 4;
+/// Bloom filter bits per neighbor, about 1% false positives with 4 hash functions
+static const uint32_t NEIGHBOR_SET_BITS_PER_ENTRY = 10;
+
+NeighborSetExtension::NeighborSetExtension()
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED(NeighborSetExtension);
+
+TypeId
+NeighborSetExtension::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::madaodv::NeighborSetExtension")
+                            .SetParent<Header>()
+                            .SetGroupName("Madaodv")
+                            .AddConstructor<NeighborSetExtension>();
+    return tid;
+}
+
+TypeId
+NeighborSetExtension::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+NeighborSetExtension::GetSerializedSize() const
+{
+    return 2 + m_filter.size();
+}
+
+void
+NeighborSetExtension::Serialize(Buffer::Iterator i) const
+{
+    i.WriteU8(MADAODVEXT_NEIGHBOR_SET);
+    i.WriteU8(m_filter.size());
+    for (std::vector<uint8_t>::const_iterator j = m_filter.begin(); j != m_filter.end(); ++j)
     {
-        if ((j->first != k->first) || (j->second != k->second))
+        i.WriteU8(*j);
+    }
+}
+
+uint32_t
+NeighborSetExtension::Deserialize(Buffer::Iterator start)
+{
+    Buffer::Iterator i = start;
+    uint8_t type = i.ReadU8();
+    NS_ASSERT(type == MADAODVEXT_NEIGHBOR_SET);
+    uint8_t length = i.ReadU8();
+    m_filter.resize(length);
+    for (uint8_t k = 0; k < length; ++k)
+    {
+        m_filter[k] = i.ReadU8();
+    }
+    uint32_t dist = i.GetDistanceFrom(start);
+    NS_ASSERT(dist == GetSerializedSize());
+    return dist;
+}
+
+void
+NeighborSetExtension::Print(std::ostream& os) const
+{
+    os << "neighbor set filter of " << m_filter.size() << " bytes";
+}
+
+void
+NeighborSetExtension::GetBits(Ipv4Address addr, std::vector<uint32_t>& bits) const
+{
+    uint8_t buf[4];
+    addr.Serialize(buf);
+    uint64_t hash = Hash64(reinterpret_cast<const char*>(buf), sizeof(buf));
+    // Double hashing: the k bit positions are h1 + i * h2
+    uint32_t h1 = hash & 0xffffffff;
+    uint32_t h2 = (hash >> 32) | 1;
+    uint32_t size = 8 * m_filter.size();
+    bits.clear();
+    for (uint32_t k = 0; k < NEIGHBOR_SET_HASHES; ++k)
+    {
+        bits.push_back((h1 + k * h2) % size);
+    }
+}
+
+void
+NeighborSetExtension::SetNeighbors(const std::vector<Ipv4Address>& neighbors)
+{
+    uint32_t bytes = (neighbors.size() * NEIGHBOR_SET_BITS_PER_ENTRY + 7) / 8;
+    m_filter.assign(std::min<uint32_t>(std::max<uint32_t>(bytes, 1), 255), 0);
+    std::vector<uint32_t> bits;
+    for (std::vector<Ipv4Address>::const_iterator i = neighbors.begin(); i != neighbors.end(); ++i)
+    {
+        GetBits(*i, bits);
+        for (std::vector<uint32_t>::const_iterator b = bits.begin(); b != bits.end(); ++b)
+        {
+            m_filter[*b / 8] |= (1 << (*b % 8));
+        }
+    }
+}
+
+bool
+NeighborSetExtension::MayContain(Ipv4Address addr) const
+{
+    if (m_filter.empty())
+    {
+        return false;
+    }
+    std::vector<uint32_t> bits;
+    GetBits(addr, bits);
+    for (std::vector<uint32_t>::const_iterator b = bits.begin(); b != bits.end(); ++b)
+    {
+        if (!(m_filter[*b / 8] & (1 << (*b % 8))))
         {
             return false;
         }
+    }
+    return true;
+}
+
+bool
+NeighborSetExtension::operator==(const NeighborSetExtension& o) const
+{
+    return m_filter == o.m_filter;
+}
+
+std::ostream&
+operator<<(std::ostream& os, const NeighborSetExtension& h)
+{
+    h.Print(os);
+    return os;
+}
+
+MultiDestinationExtension::MultiDestinationExtension()
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED(MultiDestinationExtension);
+
+TypeId
+MultiDestinationExtension::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::madaodv::MultiDestinationExtension")
+                            .SetParent<Header>()
+                            .SetGroupName("Madaodv")
+                            .AddConstructor<MultiDestinationExtension>();
+    return tid;
+}
+
+TypeId
+MultiDestinationExtension::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+MultiDestinationExtension::GetSerializedSize() const
+{
+    return 2 + 9 * m_destinations.size();
+}
+
+void
+MultiDestinationExtension::Serialize(Buffer::Iterator i) const
+{
+    i.WriteU8(MADAODVEXT_MULTI_DESTINATION);
+    i.WriteU8(9 * m_destinations.size());
+    for (std::vector<Destination>::const_iterator j = m_destinations.begin();
+         j != m_destinations.end();
+         ++j)
+    {
+        i.WriteU8(j->unknownSeqNo ? (1 << 7) : 0);
+        WriteTo(i, j->dst);
+        i.WriteHtonU32(j->seqNo);
+    }
+}
+
+uint32_t
+MultiDestinationExtension::Deserialize(Buffer::Iterator start)
+{
+    Buffer::Iterator i = start;
+    uint8_t type = i.ReadU8();
+    NS_ASSERT(type == MADAODVEXT_MULTI_DESTINATION);
+    uint8_t count = i.ReadU8() / 9;
+    m_destinations.clear();
+    for (uint8_t k = 0; k < count; ++k)
+    {
+        Destination d;
+        d.unknownSeqNo = (i.ReadU8() & (1 << 7)) != 0;
+        ReadFrom(i, d.dst);
+        d.seqNo = i.ReadNtohU32();
+        m_destinations.push_back(d);
+    }
+    uint32_t dist = i.GetDistanceFrom(start);
+    NS_ASSERT(dist == GetSerializedSize());
+    return dist;
+}
+
+void
+MultiDestinationExtension::Print(std::ostream& os) const
+{
+    os << "destinations:";
+    for (std::vector<Destination>::const_iterator j = m_destinations.begin();
+         j != m_destinations.end();
+         ++j)
+    {
+        os << " " << j->dst;
+        if (!j->unknownSeqNo)
+        {
+            os << " (" << j->seqNo << ")";
+        }
+    }
+}
 
-        j++;
-        k++;
+bool
+MultiDestinationExtension::AddDestination(Ipv4Address dst, uint32_t seqNo, bool unknownSeqNo)
+{
+    if (m_destinations.size() >= MAX_DESTINATIONS)
+    {
+        return false;
+    }
+    Destination d;
+    d.dst = dst;
+    d.seqNo = seqNo;
+    d.unknownSeqNo = unknownSeqNo;
+    m_destinations.push_back(d);
+    return true;
+}
+
+bool
+MultiDestinationExtension::operator==(const MultiDestinationExtension& o) const
+{
+    if (m_destinations.size() != o.m_destinations.size())
+    {
+        return false;
+    }
+    for (std::size_t k = 0; k < m_destinations.size(); ++k)
+    {
+        if (m_destinations[k].dst != o.m_destinations[k].dst ||
+            m_destinations[k].seqNo != o.m_destinations[k].seqNo ||
+            m_destinations[k].unknownSeqNo != o.m_destinations[k].unknownSeqNo)
+        {
+            return false;
+        }
     }
     return true;
 }
 
 std::ostream&
-operator<<(std::ostream& os, const RerrHeader& h)
+operator<<(std::ostream& os, const MultiDestinationExtension& h)
+{
+    h.Print(os);
+    return os;
+}
+
+PathExtension::PathExtension()
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED(PathExtension);
+
+TypeId
+PathExtension::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::madaodv::PathExtension")
+                            .SetParent<Header>()
+                            .SetGroupName("Madaodv")
+                            .AddConstructor<PathExtension>();
+    return tid;
+}
+
+TypeId
+PathExtension::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+PathExtension::GetSerializedSize() const
+{
+    return 2 + 4 * m_path.size();
+}
+
+void
+PathExtension::Serialize(Buffer::Iterator i) const
+{
+    i.WriteU8(MADAODVEXT_PATH);
+    i.WriteU8(4 * m_path.size());
+    for (std::vector<Ipv4Address>::const_iterator j = m_path.begin(); j != m_path.end(); ++j)
+    {
+        WriteTo(i, *j);
+    }
+}
+
+uint32_t
+PathExtension::Deserialize(Buffer::Iterator start)
+{
+    Buffer::Iterator i = start;
+    uint8_t type = i.ReadU8();
+    NS_ASSERT(type == MADAODVEXT_PATH);
+    uint8_t count = i.ReadU8() / 4;
+    m_path.clear();
+    for (uint8_t k = 0; k < count; ++k)
+    {
+        Ipv4Address node;
+        ReadFrom(i, node);
+        m_path.push_back(node);
+    }
+    uint32_t dist = i.GetDistanceFrom(start);
+    NS_ASSERT(dist == GetSerializedSize());
+    return dist;
+}
+
+void
+PathExtension::Print(std::ostream& os) const
+{
+    os << "path:";
+    for (std::vector<Ipv4Address>::const_iterator j = m_path.begin(); j != m_path.end(); ++j)
+    {
+        os << " " << *j;
+    }
+}
+
+bool
+PathExtension::AddNode(Ipv4Address node)
+{
+    if (m_path.size() >= MAX_NODES)
+    {
+        return false;
+    }
+    m_path.push_back(node);
+    return true;
+}
+
+bool
+PathExtension::operator==(const PathExtension& o) const
+{
+    return m_path == o.m_path;
+}
+
+std::ostream&
+operator<<(std::ostream& os, const PathExtension& h)
 {
     h.Print(os);
     return os;
 }
+
+LoadExtension::LoadExtension(uint32_t load)
+    : m_load(load)
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED(LoadExtension);
+
+TypeId
+LoadExtension::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::madaodv::LoadExtension")
+                            .SetParent<Header>()
+                            .SetGroupName("Madaodv")
+                            .AddConstructor<LoadExtension>();
+    return tid;
+}
+
+TypeId
+LoadExtension::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+LoadExtension::GetSerializedSize() const
+{
+    return 6;
+}
+
+void
+LoadExtension::Serialize(Buffer::Iterator i) const
+{
+    i.WriteU8(MADAODVEXT_LOAD);
+    i.WriteU8(4);
+    i.WriteHtonU32(m_load);
+}
+
+uint32_t
+LoadExtension::Deserialize(Buffer::Iterator start)
+{
+    Buffer::Iterator i = start;
+    uint8_t type = i.ReadU8();
+    NS_ASSERT(type == MADAODVEXT_LOAD);
+    i.ReadU8();
+    m_load = i.ReadNtohU32();
+    uint32_t dist = i.GetDistanceFrom(start);
+    NS_ASSERT(dist == GetSerializedSize());
+    return dist;
+}
+
+void
+LoadExtension::Print(std::ostream& os) const
+{
+    os << "load: " << m_load;
+}
+
+bool
+LoadExtension::operator==(const LoadExtension& o) const
+{
+    return m_load == o.m_load;
+}
+
+std::ostream&
+operator<<(std::ostream& os, const LoadExtension& h)
+{
+    h.Print(os);
+    return os;
+}
+
+QosExtension::QosExtension(Time delay, DataRate bandwidth)
+{
+    SetDelayBound(delay);
+    SetBandwidth(bandwidth);
+}
+
+NS_OBJECT_ENSURE_REGISTERED(QosExtension);
+
+TypeId
+QosExtension::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::madaodv::QosExtension")
+                            .SetParent<Header>()
+                            .SetGroupName("Madaodv")
+                            .AddConstructor<QosExtension>();
+    return tid;
+}
+
+TypeId
+QosExtension::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+QosExtension::GetSerializedSize() const
+{
+    return 10;
+}
+
+void
+QosExtension::Serialize(Buffer::Iterator i) const
+{
+    i.WriteU8(MADAODVEXT_QOS);
+    i.WriteU8(8);
+    i.WriteHtonU32(m_delay);
+    i.WriteHtonU32(m_bandwidth);
+}
+
+uint32_t
+QosExtension::Deserialize(Buffer::Iterator start)
+{
+    Buffer::Iterator i = start;
+    uint8_t type = i.ReadU8();
+    NS_ASSERT(type == MADAODVEXT_QOS);
+    i.ReadU8();
+    m_delay = i.ReadNtohU32();
+    m_bandwidth = i.ReadNtohU32();
+    uint32_t dist = i.GetDistanceFrom(start);
+    NS_ASSERT(dist == GetSerializedSize());
+    return dist;
+}
+
+void
+QosExtension::Print(std::ostream& os) const
+{
+    os << "delay bound: " << GetDelayBound().As(Time::MS)
+       << " bandwidth: " << m_bandwidth << " kbit/s";
+}
+
+void
+QosExtension::SetDelayBound(Time delay)
+{
+    // A positive bound must not read as no bound
+    m_delay = delay.IsStrictlyPositive() ? std::max<int64_t>(1, delay.GetMicroSeconds()) : 0;
+}
+
+Time
+QosExtension::GetDelayBound() const
+{
+    return MicroSeconds(m_delay);
+}
+
+void
+QosExtension::SetBandwidth(DataRate bandwidth)
+{
+    m_bandwidth =
+        bandwidth.GetBitRate() > 0 ? std::max<uint64_t>(1, bandwidth.GetBitRate() / 1000) : 0;
+}
+
+DataRate
+QosExtension::GetBandwidth() const
+{
+    return DataRate(uint64_t(m_bandwidth) * 1000);
+}
+
+bool
+QosExtension::operator==(const QosExtension& o) const
+{
+    return m_delay == o.m_delay && m_bandwidth == o.m_bandwidth;
+}
+
+std::ostream&
+operator<<(std::ostream& os, const QosExtension& h)
+{
+    h.Print(os);
+    return os;
+}
+
+AdvertisementExtension::AdvertisementExtension(uint32_t id)
+    : m_id(id)
+{
+}
+
+NS_OBJECT_ENSURE_REGISTERED(AdvertisementExtension);
+
+TypeId
+AdvertisementExtension::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::madaodv::AdvertisementExtension")
+                            .SetParent<Header>()
+                            .SetGroupName("Madaodv")
+                            .AddConstructor<AdvertisementExtension>();
+    return tid;
+}
+
+TypeId
+AdvertisementExtension::GetInstanceTypeId() const
+{
+    return GetTypeId();
+}
+
+uint32_t
+AdvertisementExtension::GetSerializedSize() const
+{
+    return 6;
+}
+
+void
+AdvertisementExtension::Serialize(Buffer::Iterator i) const
+{
+    i.WriteU8(MADAODVEXT_ADVERTISEMENT);
+    i.WriteU8(4);
+    i.WriteHtonU32(m_id);
+}
+
+uint32_t
+AdvertisementExtension::Deserialize(Buffer::Iterator start)
+{
+    Buffer::Iterator i = start;
+    uint8_t type = i.ReadU8();
+    NS_ASSERT(type == MADAODVEXT_ADVERTISEMENT);
+    i.ReadU8();
+    m_id = i.ReadNtohU32();
+    uint32_t dist = i.GetDistanceFrom(start);
+    NS_ASSERT(dist == GetSerializedSize());
+    return dist;
+}
+
+void
+AdvertisementExtension::Print(std::ostream& os) const
+{
+    os << "advertisement ID: " << m_id;
+}
+
+bool
+AdvertisementExtension::operator==(const AdvertisementExtension& o) const
+{
+    return m_id == o.m_id;
+}
+
+std::ostream&
+operator<<(std::ostream& os, const AdvertisementExtension& h)
+{
+    h.Print(os);
+    return os;
+}
+
 } // namespace madaodv
 } // namespace ns3
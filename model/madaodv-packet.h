@@ -27,6 +27,7 @@
 #ifndef MADAODVPACKET_H
 #define MADAODVPACKET_H
 
+#include "ns3/data-rate.h"
 #include "ns3/enum.h"
 #include "ns3/header.h"
 #include "ns3/ipv4-address.h"
@@ -34,6 +35,7 @@
 
 #include <iostream>
 #include <map>
+#include <vector>
 
 namespace ns3
 {
@@ -625,12 +627,19 @@ class RerrHeader : public Header
      */
     bool AddUnDestination(Ipv4Address dst, uint32_t seqNo);
     /**
-     * \brief Delete pair (address + sequence number) from REER header, if the number of unreachable
-     * destinations > 0
+     * \brief Delete the pair (address + sequence number) with the highest address from REER header,
+     * if the number of unreachable destinations > 0
      * \param un unreachable pair (address + sequence number)
      * \return true on success
      */
     bool RemoveUnDestination(std::pair<Ipv4Address, uint32_t>& un);
+    /**
+     * \returns the unreachable destinations (address + sequence number), sorted by address
+     */
+    const std::vector<std::pair<Ipv4Address, uint32_t>>& GetUnDestinations() const
+    {
+        return m_unreachableDstSeqNo;
+    }
     /// Clear header
     void Clear();
 
@@ -653,8 +662,8 @@ class RerrHeader : public Header
     uint8_t m_flag;     ///< No delete flag
     uint8_t m_reserved; ///< Not used (must be 0)
 
-    /// List of Unreachable destination: IP addresses and sequence numbers
-    std::map<Ipv4Address, uint32_t> m_unreachableDstSeqNo;
+    /// List of Unreachable destination: IP addresses and sequence numbers, sorted by address
+    std::vector<std::pair<Ipv4Address, uint32_t>> m_unreachableDstSeqNo;
 };
 
 /**
@@ -664,6 +673,517 @@ class RerrHeader : public Header
  */
 std::ostream& operator<<(std::ostream& os, const RerrHeader&);
 
+/**
+ * \ingroup madaodv
+ * \brief ExtensionType enumeration
+ */
+enum ExtensionType
+{
+    MADAODVEXT_NEIGHBOR_SET = 1,      //!< MADAODVEXT_NEIGHBOR_SET
+    MADAODVEXT_MULTI_DESTINATION = 2, //!< MADAODVEXT_MULTI_DESTINATION
+    MADAODVEXT_PATH = 3,              //!< MADAODVEXT_PATH
+    MADAODVEXT_LOAD = 4,              //!< MADAODVEXT_LOAD
+    MADAODVEXT_QOS = 5,               //!< MADAODVEXT_QOS
+    MADAODVEXT_ADVERTISEMENT = 6,     //!< MADAODVEXT_ADVERTISEMENT
+};
+
+/**
+* \ingroup madaodv
+* \brief Extension Format, appended to the fixed part of a message (RFC 3561, section 7)
+  \verbatim
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |     Type      |    Length     |  type-specific data ...
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  \endverbatim
+*
+* This header holds the type and length of any extension. It is used to find out which extension
+* comes next in a message and to skip extensions the receiver does not handle.
+*/
+class ExtensionHeader : public Header
+{
+  public:
+    /**
+     * constructor
+     * \param type the extension type
+     * \param length the length of the type-specific data in bytes
+     */
+    ExtensionHeader(uint8_t type = 0, uint8_t length = 0);
+
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+    void Print(std::ostream& os) const override;
+
+    /**
+     * \returns the extension type
+     */
+    uint8_t GetType() const
+    {
+        return m_type;
+    }
+
+    /**
+     * \returns the length of the type-specific data in bytes
+     */
+    uint8_t GetLength() const
+    {
+        return m_length;
+    }
+
+  private:
+    uint8_t m_type;   ///< Extension type
+    uint8_t m_length; ///< Length of the type-specific data
+};
+
+/**
+* \ingroup madaodv
+* \brief Neighbor Set Extension of a HELLO message
+  \verbatim
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |     Type      |    Length     |     Bloom filter ...
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  \endverbatim
+*
+* The addresses of the neighbors the sender of the HELLO hears are encoded in a Bloom filter of
+* Length bytes. A neighbor which is in the set is always found; a node which is not may be found
+* as well, with a small probability.
+*/
+class NeighborSetExtension : public Header
+{
+  public:
+    /// constructor
+    NeighborSetExtension();
+
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+    void Print(std::ostream& os) const override;
+
+    /**
+     * \brief Encode a neighbor set, sizing the filter for it
+     * \param neighbors the addresses of the neighbors
+     */
+    void SetNeighbors(const std::vector<Ipv4Address>& neighbors);
+    /**
+     * \brief Check whether an address may be in the neighbor set
+     * \param addr the address
+     * \returns false if the address is not in the set
+     */
+    bool MayContain(Ipv4Address addr) const;
+
+    /**
+     * \brief Comparison operator
+     * \param o extension to compare
+     * \return true if the extensions are equal
+     */
+    bool operator==(const NeighborSetExtension& o) const;
+
+  private:
+    /**
+     * \brief Compute the filter bits of an address
+     * \param addr the address
+     * \param bits the bit positions to fill, one per hash function
+     */
+    void GetBits(Ipv4Address addr, std::vector<uint32_t>& bits) const;
+
+    std::vector<uint8_t> m_filter; ///< Bloom filter of the neighbor addresses
+};
+
+/**
+ * \brief Stream output operator
+ * \param os output stream
+ * \return updated stream
+ */
+std::ostream& operator<<(std::ostream& os, const NeighborSetExtension&);
+
+/**
+* \ingroup madaodv
+* \brief Multi-Destination Extension of a RREQ message
+  \verbatim
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |     Type      |    Length     |U|  Reserved   | Destination   |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |  IP Address (1)                               | Destination   |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |  Sequence Number (1)                          |U|  Reserved   |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |  Additional destinations (if needed) ...
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  \endverbatim
+*
+* Destinations looked for by the RREQ in addition to the one of its fixed part. Each one has its
+* own 'U' flag and sequence number, with the meaning they have in the fixed part.
+*/
+class MultiDestinationExtension : public Header
+{
+  public:
+    /// A destination of the RREQ
+    struct Destination
+    {
+        Ipv4Address dst;   ///< Destination IP address
+        uint32_t seqNo;    ///< Destination sequence number
+        bool unknownSeqNo; ///< Unknown sequence number flag
+    };
+
+    /// Maximum number of destinations the extension holds
+    static const uint8_t MAX_DESTINATIONS = 28;
+
+    /// constructor
+    MultiDestinationExtension();
+
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+    void Print(std::ostream& os) const override;
+
+    /**
+     * \brief Add a destination
+     * \param dst the destination IP address
+     * \param seqNo the destination sequence number
+     * \param unknownSeqNo the unknown sequence number flag
+     * \return false if the extension is full
+     */
+    bool AddDestination(Ipv4Address dst, uint32_t seqNo, bool unknownSeqNo);
+
+    /**
+     * \returns the destinations
+     */
+    const std::vector<Destination>& GetDestinations() const
+    {
+        return m_destinations;
+    }
+
+    /**
+     * \brief Comparison operator
+     * \param o extension to compare
+     * \return true if the extensions are equal
+     */
+    bool operator==(const MultiDestinationExtension& o) const;
+
+  private:
+    std::vector<Destination> m_destinations; ///< Additional destinations
+};
+
+/**
+ * \brief Stream output operator
+ * \param os output stream
+ * \return updated stream
+ */
+std::ostream& operator<<(std::ostream& os, const MultiDestinationExtension&);
+
+/**
+* \ingroup madaodv
+* \brief Path Accumulation Extension of a RREQ or RREP message
+  \verbatim
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |     Type      |    Length     |  Node IP Address (1)          |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |                               |  Additional nodes (if needed) |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  \endverbatim
+*
+* Addresses of the nodes which forwarded the message, in the order it went through them. The
+* originator of a RREQ and the destination of a RREP are not listed, they are in the fixed part.
+*/
+class PathExtension : public Header
+{
+  public:
+    /// Maximum number of nodes the extension holds
+    static const uint8_t MAX_NODES = 63;
+
+    /// constructor
+    PathExtension();
+
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+    void Print(std::ostream& os) const override;
+
+    /**
+     * \brief Append a node at the end of the path
+     * \param node the node IP address
+     * \return false if the extension is full
+     */
+    bool AddNode(Ipv4Address node);
+
+    /**
+     * \returns the nodes of the path, the last one is the latest forwarder
+     */
+    const std::vector<Ipv4Address>& GetPath() const
+    {
+        return m_path;
+    }
+
+    /**
+     * \brief Comparison operator
+     * \param o extension to compare
+     * \return true if the extensions are equal
+     */
+    bool operator==(const PathExtension& o) const;
+
+  private:
+    std::vector<Ipv4Address> m_path; ///< Nodes of the path
+};
+
+/**
+ * \brief Stream output operator
+ * \param os output stream
+ * \return updated stream
+ */
+std::ostream& operator<<(std::ostream& os, const PathExtension&);
+
+/**
+* \ingroup madaodv
+* \brief Path Load Extension of a RREQ message
+  \verbatim
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |     Type      |    Length     |            Load               |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |            (cont)             |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  \endverbatim
+*
+* Number of frames waiting in the interface queues of the nodes the RREQ went through, summed
+* along its path.
+*/
+class LoadExtension : public Header
+{
+  public:
+    /**
+     * constructor
+     * \param load the cumulative load
+     */
+    LoadExtension(uint32_t load = 0);
+
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+    void Print(std::ostream& os) const override;
+
+    /**
+     * \brief Set the cumulative load
+     * \param load the number of queued frames along the path
+     */
+    void SetLoad(uint32_t load)
+    {
+        m_load = load;
+    }
+
+    /**
+     * \returns the number of queued frames along the path
+     */
+    uint32_t GetLoad() const
+    {
+        return m_load;
+    }
+
+    /**
+     * \brief Comparison operator
+     * \param o extension to compare
+     * \return true if the extensions are equal
+     */
+    bool operator==(const LoadExtension& o) const;
+
+  private:
+    uint32_t m_load; ///< Cumulative load of the path
+};
+
+/**
+ * \brief Stream output operator
+ * \param os output stream
+ * \return updated stream
+ */
+std::ostream& operator<<(std::ostream& os, const LoadExtension&);
+
+/**
+* \ingroup madaodv
+* \brief QoS Extension of a RREQ message
+  \verbatim
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |     Type      |    Length     |     Delay Bound (in us)       |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |            (cont)             |    Bandwidth (in kbit/s)      |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |            (cont)             |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  \endverbatim
+*
+* Bounds the path of a RREQ must meet. The delay bound is what is left of the end-to-end delay
+* budget once the delay of the nodes the RREQ went through is spent. A zero field sets no bound.
+*/
+class QosExtension : public Header
+{
+  public:
+    /**
+     * constructor
+     * \param delay the delay bound
+     * \param bandwidth the bandwidth each link must offer
+     */
+    QosExtension(Time delay = Seconds(0), DataRate bandwidth = DataRate(0));
+
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+    void Print(std::ostream& os) const override;
+
+    /**
+     * \brief Set the delay bound, truncated to microseconds
+     * \param delay the delay bound, 0 for none
+     */
+    void SetDelayBound(Time delay);
+    /**
+     * \returns the delay bound, 0 for none
+     */
+    Time GetDelayBound() const;
+
+    /**
+     * \brief Set the bandwidth bound, truncated to kbit/s
+     * \param bandwidth the bandwidth each link must offer, 0 for none
+     */
+    void SetBandwidth(DataRate bandwidth);
+    /**
+     * \returns the bandwidth each link must offer, 0 for none
+     */
+    DataRate GetBandwidth() const;
+
+    /**
+     * \brief Comparison operator
+     * \param o extension to compare
+     * \return true if the extensions are equal
+     */
+    bool operator==(const QosExtension& o) const;
+
+  private:
+    uint32_t m_delay;     ///< Delay bound, in microseconds
+    uint32_t m_bandwidth; ///< Bandwidth bound, in kbit/s
+};
+
+/**
+ * \brief Stream output operator
+ * \param os output stream
+ * \return updated stream
+ */
+std::ostream& operator<<(std::ostream& os, const QosExtension&);
+
+/**
+* \ingroup madaodv
+* \brief Advertisement Extension of a route advertisement
+  \verbatim
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |     Type      |    Length     |       Advertisement ID        |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  |            (cont)             |
+  +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  \endverbatim
+*
+* Identifies the flood of one route advertisement, like the RREQ ID does for a RREQ. The
+* advertised sequence number only changes with the route, so it cannot tell two floods apart.
+*/
+class AdvertisementExtension : public Header
+{
+  public:
+    /**
+     * constructor
+     * \param id the advertisement ID
+     */
+    AdvertisementExtension(uint32_t id = 0);
+
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId();
+    TypeId GetInstanceTypeId() const override;
+    uint32_t GetSerializedSize() const override;
+    void Serialize(Buffer::Iterator start) const override;
+    uint32_t Deserialize(Buffer::Iterator start) override;
+    void Print(std::ostream& os) const override;
+
+    /**
+     * \brief Set the advertisement ID
+     * \param id the advertisement ID
+     */
+    void SetId(uint32_t id)
+    {
+        m_id = id;
+    }
+
+    /**
+     * \returns the advertisement ID
+     */
+    uint32_t GetId() const
+    {
+        return m_id;
+    }
+
+    /**
+     * \brief Comparison operator
+     * \param o extension to compare
+     * \return true if the extensions are equal
+     */
+    bool operator==(const AdvertisementExtension& o) const;
+
+  private:
+    uint32_t m_id; ///< Advertisement ID
+};
+
+/**
+ * \brief Stream output operator
+ * \param os output stream
+ * \return updated stream
+ */
+std::ostream& operator<<(std::ostream& os, const AdvertisementExtension&);
+
 } // namespace madaodv
 } // namespace ns3
 
@@ -33,18 +33,28 @@
 #include "madaodv-routing-protocol.h"
 
 #include "ns3/adhoc-wifi-mac.h"
+#include "ns3/ampdu-subframe-header.h"
 #include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/enum.h"
+#include "ns3/hash.h"
+#include "ns3/icmpv4-l4-protocol.h"
 #include "ns3/inet-socket-address.h"
+#include "ns3/llc-snap-header.h"
 #include "ns3/log.h"
 #include "ns3/pointer.h"
 #include "ns3/random-variable-stream.h"
 #include "ns3/string.h"
+#include "ns3/tcp-l4-protocol.h"
 #include "ns3/trace-source-accessor.h"
 #include "ns3/udp-header.h"
 #include "ns3/udp-l4-protocol.h"
 #include "ns3/udp-socket-factory.h"
+#include "ns3/wifi-mac-queue.h"
 #include "ns3/wifi-mpdu.h"
 #include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/wifi-remote-station-manager.h"
 
 #include <algorithm>
 #include <limits>
@@ -141,6 +151,139 @@ class DeferredRouteOutputTag : public Tag
 
 NS_OBJECT_ENSURE_REGISTERED(DeferredRouteOutputTag);
 
+/**
+ * \ingroup madaodv
+ * \brief Route refresh and RREP_ACK piggybacked by MADAODV on unicast packets
+ *
+ * The tag stands for a compact shim carrying the address and sequence number of the transmitting
+ * node and whether the packet acknowledges a RREP received from the next hop. The next hop is
+ * named by the MAC header on the air, the tag keeps it for the transmitting node.
+ */
+class PiggybackTag : public Tag
+{
+  public:
+    /**
+     * \brief Constructor
+     * \param sender the address of the transmitting node
+     * \param nextHop the address of the next hop
+     * \param seqNo the sequence number of the transmitting node
+     * \param ack whether the tag acknowledges a RREP
+     */
+    PiggybackTag(Ipv4Address sender = Ipv4Address(),
+                 Ipv4Address nextHop = Ipv4Address(),
+                 uint32_t seqNo = 0,
+                 bool ack = false)
+        : Tag(),
+          m_sender(sender),
+          m_nextHop(nextHop),
+          m_seqNo(seqNo),
+          m_ack(ack)
+    {
+    }
+
+    /**
+     * \brief Get the type ID.
+     * \return the object TypeId
+     */
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::madaodv::PiggybackTag")
+                                .SetParent<Tag>()
+                                .SetGroupName("Madaodv")
+                                .AddConstructor<PiggybackTag>();
+        return tid;
+    }
+
+    TypeId GetInstanceTypeId() const override
+    {
+        return GetTypeId();
+    }
+
+    /**
+     * \brief Get the address of the transmitting node
+     * \return the address
+     */
+    Ipv4Address GetSender() const
+    {
+        return m_sender;
+    }
+
+    /**
+     * \brief Get the address of the next hop
+     * \return the address
+     */
+    Ipv4Address GetNextHop() const
+    {
+        return m_nextHop;
+    }
+
+    /**
+     * \brief Get the sequence number of the transmitting node
+     * \return the sequence number
+     */
+    uint32_t GetSeqNo() const
+    {
+        return m_seqNo;
+    }
+
+    /**
+     * \brief Check whether the tag acknowledges a RREP
+     * \return the acknowledgment flag
+     */
+    bool GetAck() const
+    {
+        return m_ack;
+    }
+
+    /**
+     * \brief Set the acknowledgment flag
+     * \param ack the acknowledgment flag
+     */
+    void SetAck(bool ack)
+    {
+        m_ack = ack;
+    }
+
+    uint32_t GetSerializedSize() const override
+    {
+        return 3 * sizeof(uint32_t) + sizeof(uint8_t);
+    }
+
+    void Serialize(TagBuffer i) const override
+    {
+        i.WriteU32(m_sender.Get());
+        i.WriteU32(m_nextHop.Get());
+        i.WriteU32(m_seqNo);
+        i.WriteU8(m_ack);
+    }
+
+    void Deserialize(TagBuffer i) override
+    {
+        m_sender.Set(i.ReadU32());
+        m_nextHop.Set(i.ReadU32());
+        m_seqNo = i.ReadU32();
+        m_ack = i.ReadU8();
+    }
+
+    void Print(std::ostream& os) const override
+    {
+        os << "PiggybackTag: sender = " << m_sender << ", nextHop = " << m_nextHop
+           << ", seqNo = " << m_seqNo << ", ack = " << m_ack;
+    }
+
+  private:
+    /// Address of the transmitting node
+    Ipv4Address m_sender;
+    /// Address of the next hop
+    Ipv4Address m_nextHop;
+    /// Sequence number of the transmitting node
+    uint32_t m_seqNo;
+    /// Whether the tag acknowledges a RREP
+    bool m_ack;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(PiggybackTag);
+
 //-----------------------------------------------------------------------------
 RoutingProtocol::RoutingProtocol()
     : m_rreqRetries(2),
@@ -156,8 +299,13 @@ RoutingProtocol::RoutingProtocol()
       m_netTraversalTime(Time((2 * m_netDiameter) * m_nodeTraversalTime)),
       m_pathDiscoveryTime(Time(2 * m_netTraversalTime)),
       m_myRouteTimeout(Time(2 * std::max(m_pathDiscoveryTime, m_activeRouteTimeout))),
+      m_enableAdaptiveRouteTimeout(false),
+      m_minActiveRouteTimeout(Seconds(1)),
+      m_maxActiveRouteTimeout(Seconds(30)),
       m_helloInterval(Seconds(1)),
       m_allowedHelloLoss(2),
+      m_enableAdaptiveHello(false),
+      m_maxHelloInterval(Seconds(16)),
       m_deletePeriod(Time(5 * std::max(m_activeRouteTimeout, m_helloInterval))),
       m_nextHopWait(m_nodeTraversalTime + MilliSeconds(10)),
       m_blackListTimeout(Time(m_rreqRetries * m_netTraversalTime)),
@@ -166,6 +314,35 @@ RoutingProtocol::RoutingProtocol()
       m_destinationOnly(false),
       m_gratuitousReply(true),
       m_enableHello(false),
+      m_enableDirectDeferral(false),
+      m_rreqSuppression(RREQ_SUPPRESSION_NONE),
+      m_rreqSuppressionCounter(3),
+      m_rreqGossipProbability(0.65),
+      m_rreqGossipHops(1),
+      m_enableLocalRepair(false),
+      m_maxRepairTtl(10),
+      m_localAddTtl(2),
+      m_enableMultipath(false),
+      m_maxPaths(3),
+      m_enableStriping(false),
+      m_enablePreemptiveMaintenance(false),
+      m_preemptiveRetryThreshold(3),
+      m_preemptiveRssiThreshold(-90),
+      m_enableSalvage(false),
+      m_enablePiggyback(false),
+      m_enableHelloNeighborSet(false),
+      m_rreqAggregationWindow(Seconds(0)),
+      m_enablePathAccumulation(false),
+      m_maxPathLength(10),
+      m_enablePromiscuousLearning(false),
+      m_advertiseInterval(Seconds(0)),
+      m_advertId(0),
+      m_rreqHoldTime(Seconds(0)),
+      m_jitterPerNeighbor(Seconds(0)),
+      m_maxJitter(MilliSeconds(100)),
+      m_enableJitterRssiBias(false),
+      m_enableLoadAwareness(false),
+      m_loadPerHop(10),
       m_routingTable(m_deletePeriod),
       m_queue(m_maxQueueLen, m_maxQueueTime),
       m_requestId(0),
@@ -178,9 +355,12 @@ RoutingProtocol::RoutingProtocol()
       m_htimer(Timer::CANCEL_ON_DESTROY),
       m_rreqRateLimitTimer(Timer::CANCEL_ON_DESTROY),
       m_rerrRateLimitTimer(Timer::CANCEL_ON_DESTROY),
+      m_advertTimer(Timer::CANCEL_ON_DESTROY),
       m_lastBcastTime(Seconds(0))
 {
     m_nb.SetCallback(MakeCallback(&RoutingProtocol::SendRerrWhenBreaksLinkToNextHop, this));
+    m_nb.SetNeighborChangeCallback(MakeCallback(&RoutingProtocol::NeighborChange, this));
+    m_routingTable.SetRouteStateCallback(MakeCallback(&RoutingProtocol::RouteStateChanged, this));
 }
 
 TypeId
@@ -196,6 +376,18 @@ RoutingProtocol::GetTypeId()
                           TimeValue(Seconds(1)),
                           MakeTimeAccessor(&RoutingProtocol::m_helloInterval),
                           MakeTimeChecker())
+            .AddAttribute("EnableAdaptiveHello",
+                          "Indicates whether the HELLO interval doubles, up to MaxHelloInterval, "
+                          "while the neighbor set is stable and falls back to HelloInterval when "
+                          "a neighbor appears or disappears.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enableAdaptiveHello),
+                          MakeBooleanChecker())
+            .AddAttribute("MaxHelloInterval",
+                          "Maximum HELLO messages emission interval in adaptive mode.",
+                          TimeValue(Seconds(16)),
+                          MakeTimeAccessor(&RoutingProtocol::m_maxHelloInterval),
+                          MakeTimeChecker())
             .AddAttribute("TtlStart",
                           "Initial TTL value for RREQ.",
                           UintegerValue(1),
@@ -257,6 +449,28 @@ RoutingProtocol::GetTypeId()
                           TimeValue(Seconds(11.2)),
                           MakeTimeAccessor(&RoutingProtocol::m_myRouteTimeout),
                           MakeTimeChecker())
+            .AddAttribute("EnableAdaptiveRouteTimeout",
+                          "Indicates whether the lifetime of active routes follows the observed "
+                          "lifetime of the link to their next hop instead of ActiveRouteTimeout.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enableAdaptiveRouteTimeout),
+                          MakeBooleanChecker())
+            .AddAttribute("MinActiveRouteTimeout",
+                          "Lower bound of the active route lifetime in adaptive mode.",
+                          TimeValue(Seconds(1)),
+                          MakeTimeAccessor(&RoutingProtocol::m_minActiveRouteTimeout),
+                          MakeTimeChecker())
+            .AddAttribute("MaxActiveRouteTimeout",
+                          "Upper bound of the active route lifetime in adaptive mode.",
+                          TimeValue(Seconds(30)),
+                          MakeTimeAccessor(&RoutingProtocol::m_maxActiveRouteTimeout),
+                          MakeTimeChecker())
+            .AddAttribute("LinkLifetimeWeight",
+                          "Weight of the newest sample in the moving average of link lifetimes.",
+                          DoubleValue(0.25),
+                          MakeDoubleAccessor(&RoutingProtocol::SetLinkLifetimeWeight,
+                                             &RoutingProtocol::GetLinkLifetimeWeight),
+                          MakeDoubleChecker<double>(0.0, 1.0))
             .AddAttribute("BlackListTimeout",
                           "Time for which the node is put into the blacklist = RreqRetries * "
                           "NetTraversalTime",
@@ -332,11 +546,200 @@ RoutingProtocol::GetTypeId()
                           MakeBooleanAccessor(&RoutingProtocol::SetBroadcastEnable,
                                               &RoutingProtocol::GetBroadcastEnable),
                           MakeBooleanChecker())
+            .AddAttribute("EnableDirectDeferral",
+                          "Indicates whether packets without a route are queued as soon as the "
+                          "transport layer hands them to IP, instead of being looped back "
+                          "through the loopback device.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enableDirectDeferral),
+                          MakeBooleanChecker())
+            .AddAttribute("RreqSuppression",
+                          "Scheme used to suppress redundant RREQ rebroadcasts.",
+                          EnumValue(RREQ_SUPPRESSION_NONE),
+                          MakeEnumAccessor(&RoutingProtocol::m_rreqSuppression),
+                          MakeEnumChecker(RREQ_SUPPRESSION_NONE,
+                                          "None",
+                                          RREQ_SUPPRESSION_COUNTER,
+                                          "Counter",
+                                          RREQ_SUPPRESSION_GOSSIP,
+                                          "Gossip",
+                                          RREQ_SUPPRESSION_COVERAGE,
+                                          "Coverage"))
+            .AddAttribute("RreqSuppressionCounter",
+                          "Counter scheme: number of overheard copies of a RREQ which cancel "
+                          "its rebroadcast.",
+                          UintegerValue(3),
+                          MakeUintegerAccessor(&RoutingProtocol::m_rreqSuppressionCounter),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("RreqGossipProbability",
+                          "Gossip scheme: probability to rebroadcast a RREQ.",
+                          DoubleValue(0.65),
+                          MakeDoubleAccessor(&RoutingProtocol::m_rreqGossipProbability),
+                          MakeDoubleChecker<double>(0.0, 1.0))
+            .AddAttribute("RreqGossipHops",
+                          "Gossip scheme: RREQs which travelled at most this number of hops are "
+                          "always rebroadcast.",
+                          UintegerValue(1),
+                          MakeUintegerAccessor(&RoutingProtocol::m_rreqGossipHops),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("EnableLocalRepair",
+                          "Indicates whether an intermediate node repairs a broken route itself "
+                          "instead of reporting the break to the source.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enableLocalRepair),
+                          MakeBooleanChecker())
+            .AddAttribute("MaxRepairTtl",
+                          "Maximum number of hops to a destination for which a broken route is "
+                          "repaired locally.",
+                          UintegerValue(10),
+                          MakeUintegerAccessor(&RoutingProtocol::m_maxRepairTtl),
+                          MakeUintegerChecker<uint16_t>())
+            .AddAttribute("LocalAddTtl",
+                          "Value added to the last known hop count to the destination to get "
+                          "the TTL of a local repair RREQ.",
+                          UintegerValue(2),
+                          MakeUintegerAccessor(&RoutingProtocol::m_localAddTtl),
+                          MakeUintegerChecker<uint16_t>())
+            .AddAttribute("EnableMultipath",
+                          "Indicates whether alternate paths learned from duplicate RREQs and "
+                          "RREPs are kept, so that a link break fails over without discovery.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enableMultipath),
+                          MakeBooleanChecker())
+            .AddAttribute("MaxPaths",
+                          "Maximum number of paths kept per destination, the route included.",
+                          UintegerValue(3),
+                          MakeUintegerAccessor(&RoutingProtocol::m_maxPaths),
+                          MakeUintegerChecker<uint32_t>(1))
+            .AddAttribute("EnableStriping",
+                          "Indicates whether flows are spread over the alternate paths kept in "
+                          "multipath mode. Packets of one flow always take the same path.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enableStriping),
+                          MakeBooleanChecker())
+            .AddAttribute("EnablePreemptiveMaintenance",
+                          "Indicates whether routes over a link predicted to fail, from MAC "
+                          "retries or a fading signal, are rediscovered before the link breaks.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enablePreemptiveMaintenance),
+                          MakeBooleanChecker())
+            .AddAttribute("PreemptiveRetryThreshold",
+                          "Number of consecutive MAC transmission failures after which a link is "
+                          "predicted to fail, 0 to disable.",
+                          UintegerValue(3),
+                          MakeUintegerAccessor(&RoutingProtocol::m_preemptiveRetryThreshold),
+                          MakeUintegerChecker<uint32_t>())
+            .AddAttribute("PreemptiveRssiThreshold",
+                          "Smoothed received signal strength (dBm) below which a link whose "
+                          "signal keeps fading is predicted to fail.",
+                          DoubleValue(-90),
+                          MakeDoubleAccessor(&RoutingProtocol::m_preemptiveRssiThreshold),
+                          MakeDoubleChecker<double>())
+            .AddAttribute("EnableSalvage",
+                          "Indicates whether the IP packet of a data frame the MAC gave up on is "
+                          "sent again on another route or after rediscovery instead of lost.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enableSalvage),
+                          MakeBooleanChecker())
+            .AddAttribute("EnablePiggyback",
+                          "Indicates whether unicast packets carry the sequence number of the "
+                          "transmitting node and pending RREP_ACKs, so that they refresh the "
+                          "route to it and replace HELLO and RREP_ACK messages.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enablePiggyback),
+                          MakeBooleanChecker())
+            .AddAttribute("EnableHelloNeighborSet",
+                          "Indicates whether HELLO messages carry the set of neighbors the sender "
+                          "hears, so that receivers detect unidirectional links in advance.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enableHelloNeighborSet),
+                          MakeBooleanChecker())
+            .AddAttribute("RreqAggregationWindow",
+                          "Time during which route discoveries started by this node are collected "
+                          "into a single RREQ carrying several destinations, 0 to disable.",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&RoutingProtocol::m_rreqAggregationWindow),
+                          MakeTimeChecker())
+            .AddAttribute("EnablePathAccumulation",
+                          "Indicates whether RREQ and RREP messages accumulate the addresses of "
+                          "their forwarders, so that every node on the way learns routes to them.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enablePathAccumulation),
+                          MakeBooleanChecker())
+            .AddAttribute("MaxPathLength",
+                          "Maximum number of addresses accumulated in a RREQ or RREP, the path is "
+                          "dropped beyond it.",
+                          UintegerValue(10),
+                          MakeUintegerAccessor(&RoutingProtocol::m_maxPathLength),
+                          MakeUintegerChecker<uint32_t>(1, PathExtension::MAX_NODES))
+            .AddAttribute("EnablePromiscuousLearning",
+                          "Indicates whether routes are learned from the RREP and RERR messages "
+                          "overheard on the Wi-Fi channel while addressed to other nodes.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enablePromiscuousLearning),
+                          MakeBooleanChecker())
+            .AddAttribute("AdvertiseInterval",
+                          "Interval between the route advertisements this node floods so that "
+                          "every node keeps a route to it, 0 to disable. Meant for the few "
+                          "destinations most nodes talk to, such as gateways.",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&RoutingProtocol::m_advertiseInterval),
+                          MakeTimeChecker())
+            .AddAttribute("RreqHoldTime",
+                          "Time the copies of a RREQ are compared after the first one, so that "
+                          "the reverse route follows the best of them, 0 to disable. The "
+                          "destination holds its RREP as long.",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&RoutingProtocol::m_rreqHoldTime),
+                          MakeTimeChecker())
+            .AddAttribute("JitterPerNeighbor",
+                          "Width of the random jitter of control broadcasts per current neighbor, "
+                          "so that dense regions spread their broadcasts over a longer window. "
+                          "0 keeps the fixed 10 ms window.",
+                          TimeValue(Seconds(0)),
+                          MakeTimeAccessor(&RoutingProtocol::m_jitterPerNeighbor),
+                          MakeTimeChecker())
+            .AddAttribute("MaxJitter",
+                          "Maximum width of the jitter window scaled by JitterPerNeighbor.",
+                          TimeValue(MilliSeconds(100)),
+                          MakeTimeAccessor(&RoutingProtocol::m_maxJitter),
+                          MakeTimeChecker())
+            .AddAttribute("EnableJitterRssiBias",
+                          "Indicates whether a node rebroadcasting a flooded message draws its "
+                          "jitter from the early part of the window the weaker the signal of the "
+                          "neighbor it came from, so that the relays furthest from it go first.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enableJitterRssiBias),
+                          MakeBooleanChecker())
+            .AddAttribute("EnableLoadAwareness",
+                          "Indicates whether RREQs sum the Wi-Fi MAC queue occupancy of the nodes "
+                          "they go through, so that the reverse route avoids loaded relays. Takes "
+                          "effect with RreqHoldTime.",
+                          BooleanValue(false),
+                          MakeBooleanAccessor(&RoutingProtocol::m_enableLoadAwareness),
+                          MakeBooleanChecker())
+            .AddAttribute("LoadPerHop",
+                          "Number of frames queued along a path which weigh as much as one more "
+                          "hop.",
+                          UintegerValue(10),
+                          MakeUintegerAccessor(&RoutingProtocol::m_loadPerHop),
+                          MakeUintegerChecker<uint32_t>(1))
             .AddAttribute("UniformRv",
                           "Access to the underlying UniformRandomVariable",
                           StringValue("ns3::UniformRandomVariable"),
                           MakePointerAccessor(&RoutingProtocol::m_uniformRandomVariable),
-                          MakePointerChecker<UniformRandomVariable>());
+                          MakePointerChecker<UniformRandomVariable>())
+            .AddTraceSource("RouteState",
+                            "A route became valid or stopped being valid, or a route discovery "
+                            "failed.",
+                            MakeTraceSourceAccessor(&RoutingProtocol::m_routeStateTrace),
+                            "ns3::madaodv::RoutingProtocol::RouteStateTracedCallback")
+            .AddTraceSource("Drop",
+                            "A packet which the protocol held outside of the IP layer, e.g. with "
+                            "direct deferral, has been dropped. The reason is the one Ipv4 "
+                            "reports for the same drop.",
+                            MakeTraceSourceAccessor(&RoutingProtocol::m_dropTrace),
+                            "ns3::Ipv4L3Protocol::DropTracedCallback");
     return tid;
 }
 
@@ -361,6 +764,29 @@ RoutingProtocol::~RoutingProtocol()
 void
 RoutingProtocol::DoDispose()
 {
+    for (auto i = m_downTargets.begin(); i != m_downTargets.end(); ++i)
+    {
+        i->second.first->SetDownTarget(i->second.second);
+    }
+    m_downTargets.clear();
+    for (auto i = m_pendingRreq.begin(); i != m_pendingRreq.end(); ++i)
+    {
+        i->second.event.Cancel();
+    }
+    m_pendingRreq.clear();
+    for (auto i = m_heldRreq.begin(); i != m_heldRreq.end(); ++i)
+    {
+        i->second.event.Cancel();
+    }
+    m_heldRreq.clear();
+    for (auto i = m_pendingAck.begin(); i != m_pendingAck.end(); ++i)
+    {
+        i->second.Cancel();
+    }
+    m_pendingAck.clear();
+    m_aggregationEvent.Cancel();
+    m_aggregatedRequests.clear();
+    m_advertTimer.Cancel();
     m_ipv4 = nullptr;
     for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::iterator iter = m_socketAddresses.begin();
          iter != m_socketAddresses.end();
@@ -377,6 +803,7 @@ RoutingProtocol::DoDispose()
         iter->first->Close();
     }
     m_socketSubnetBroadcastAddresses.clear();
+    m_interfaces.clear();
     Ipv4RoutingProtocol::DoDispose();
 }
 
@@ -413,6 +840,36 @@ RoutingProtocol::Start()
 
     m_rerrRateLimitTimer.SetFunction(&RoutingProtocol::RerrRateLimitTimerExpire, this);
     m_rerrRateLimitTimer.Schedule(Seconds(1));
+
+    if (m_enableDirectDeferral)
+    {
+        InstallDirectDeferral();
+    }
+    if (m_enablePiggyback)
+    {
+        m_ipv4->TraceConnectWithoutContext("Tx",
+                                           MakeCallback(&RoutingProtocol::NotifyPiggybackTx, this));
+    }
+}
+
+void
+RoutingProtocol::InstallDirectDeferral()
+{
+    NS_LOG_FUNCTION(this);
+    const uint8_t protocols[] = {UdpL4Protocol::PROT_NUMBER,
+                                 TcpL4Protocol::PROT_NUMBER,
+                                 Icmpv4L4Protocol::PROT_NUMBER};
+    for (uint8_t protocolNumber : protocols)
+    {
+        Ptr<IpL4Protocol> protocol = m_ipv4->GetProtocol(protocolNumber);
+        if (!protocol || m_downTargets.find(protocolNumber) != m_downTargets.end())
+        {
+            continue;
+        }
+        NS_LOG_LOGIC("Intercept down target of protocol " << (uint16_t)protocolNumber);
+        m_downTargets[protocolNumber] = std::make_pair(protocol, protocol->GetDownTarget());
+        protocol->SetDownTarget(MakeCallback(&RoutingProtocol::DirectDeferralSend, this));
+    }
 }
 
 Ptr<Ipv4Route>
@@ -438,9 +895,9 @@ RoutingProtocol::RouteOutput(Ptr<Packet> p,
     Ptr<Ipv4Route> route;
     Ipv4Address dst = header.GetDestination();
     RoutingTableEntry rt;
-    if (m_routingTable.LookupValidRoute(dst, rt))
+    if (m_routingTable.LookupLongestPrefixRoute(dst, rt))
     {
-        route = rt.GetRoute();
+        route = oif ? rt.GetRoute() : SelectRoute(rt, p, header, true);
         NS_ASSERT(route);
         NS_LOG_DEBUG("Exist route to " << route->GetDestination() << " from interface "
                                        << route->GetSource());
@@ -450,17 +907,25 @@ RoutingProtocol::RouteOutput(Ptr<Packet> p,
             sockerr = Socket::ERROR_NOROUTETOHOST;
             return Ptr<Ipv4Route>();
         }
-        UpdateRouteLifeTime(dst, m_activeRouteTimeout);
-        UpdateRouteLifeTime(route->GetGateway(), m_activeRouteTimeout);
+        Time lifetime = GetActiveRouteTimeout(route->GetGateway());
+        UpdateRouteLifeTime(rt.GetDestination(), lifetime);
+        UpdateRouteLifeTime(route->GetGateway(), lifetime);
+        AttachPiggyback(p, route);
         return route;
     }
 
     // Valid route not found, in this case we return loopback.
     // Actual route request will be deferred until packet will be fully formed,
     // routed to loopback, received from loopback and passed to RouteInput (see below)
+    NS_LOG_DEBUG("Valid Route not found");
+    if (m_enableDirectDeferral && !oif)
+    {
+        // The transport protocol hands the packet to DirectDeferralSend, which queues it
+        // without the loopback round trip
+        return LoopbackRoute(header, oif);
+    }
     uint32_t iif = (oif ? m_ipv4->GetInterfaceForDevice(oif) : -1);
     DeferredRouteOutputTag tag(iif);
-    NS_LOG_DEBUG("Valid Route not found");
     if (!p->PeekPacketTag(tag))
     {
         p->AddPacketTag(tag);
@@ -517,13 +982,22 @@ RoutingProtocol::RouteInput(Ptr<const Packet> p,
     Ipv4Address dst = header.GetDestination();
     Ipv4Address origin = header.GetSource();
 
+    if (m_enablePiggyback && idev != m_lo)
+    {
+        p = ProcessPiggyback(p, iif);
+    }
+
     // Deferred route request
     if (idev == m_lo)
     {
         DeferredRouteOutputTag tag;
-        if (p->PeekPacketTag(tag))
+        if (p->PeekPacketTag(tag) ||
+            (m_enableDirectDeferral && !m_ipv4->IsDestinationAddress(dst, iif)))
         {
-            DeferredRouteOutput(p, header, ucb, ecb);
+            // compensate extra TTL decrement by fake loopback routing
+            Ipv4Header loopedHeader = header;
+            loopedHeader.SetTtl(header.GetTtl() + 1);
+            DeferredRouteOutput(p, loopedHeader, ucb, ecb);
             return true;
         }
     }
@@ -541,82 +1015,82 @@ RoutingProtocol::RouteInput(Ptr<const Packet> p,
     }
 
     // Broadcast local delivery/forwarding
-    for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin();
-         j != m_socketAddresses.end();
-         ++j)
+    if (static_cast<uint32_t>(iif) < m_interfaces.size() && m_interfaces[iif].socket)
     {
-        Ipv4InterfaceAddress iface = j->second;
-        if (m_ipv4->GetInterfaceForAddress(iface.GetLocal()) == iif)
+        const Ipv4InterfaceAddress& iface = m_interfaces[iif].address;
+        if (dst == iface.GetBroadcast() || dst.IsBroadcast())
         {
-            if (dst == iface.GetBroadcast() || dst.IsBroadcast())
+            if (m_dpd.IsDuplicate(p, header))
             {
-                if (m_dpd.IsDuplicate(p, header))
-                {
-                    NS_LOG_DEBUG("Duplicated packet " << p->GetUid() << " from " << origin
-                                                      << ". Drop.");
-                    return true;
-                }
-                UpdateRouteLifeTime(origin, m_activeRouteTimeout);
-                Ptr<Packet> packet = p->Copy();
-                if (lcb.IsNull() == false)
-                {
-                    NS_LOG_LOGIC("Broadcast local delivery to " << iface.GetLocal());
-                    lcb(p, header, iif);
-                    // Fall through to additional processing
-                }
-                else
-                {
-                    NS_LOG_ERROR("Unable to deliver packet locally due to null callback "
-                                 << p->GetUid() << " from " << origin);
-                    ecb(p, header, Socket::ERROR_NOROUTETOHOST);
-                }
-                if (!m_enableBroadcast)
+                NS_LOG_DEBUG("Duplicated packet " << p->GetUid() << " from " << origin
+                                                  << ". Drop.");
+                return true;
+            }
+            UpdateRouteLifeTime(origin, m_activeRouteTimeout);
+            if (lcb.IsNull() == false)
+            {
+                NS_LOG_LOGIC("Broadcast local delivery to " << iface.GetLocal());
+                lcb(p, header, iif);
+                // Fall through to additional processing
+            }
+            else
+            {
+                NS_LOG_ERROR("Unable to deliver packet locally due to null callback "
+                             << p->GetUid() << " from " << origin);
+                ecb(p, header, Socket::ERROR_NOROUTETOHOST);
+            }
+            if (!m_enableBroadcast)
+            {
+                return true;
+            }
+            if (header.GetProtocol() == UdpL4Protocol::PROT_NUMBER)
+            {
+                UdpHeader udpHeader;
+                p->PeekHeader(udpHeader);
+                if (udpHeader.GetDestinationPort() == MADAODV_PORT)
                 {
+                    // MADAODV packets sent in broadcast are already managed
                     return true;
                 }
-                if (header.GetProtocol() == UdpL4Protocol::PROT_NUMBER)
-                {
-                    UdpHeader udpHeader;
-                    p->PeekHeader(udpHeader);
-                    if (udpHeader.GetDestinationPort() == MADAODV_PORT)
-                    {
-                        // MADAODV packets sent in broadcast are already managed
-                        return true;
-                    }
-                }
-                if (header.GetTtl() > 1)
+            }
+            if (header.GetTtl() > 1)
+            {
+                NS_LOG_LOGIC("Forward broadcast. TTL " << (uint16_t)header.GetTtl());
+                RoutingTableEntry toBroadcast;
+                if (m_routingTable.LookupRoute(dst, toBroadcast))
                 {
-                    NS_LOG_LOGIC("Forward broadcast. TTL " << (uint16_t)header.GetTtl());
-                    RoutingTableEntry toBroadcast;
-                    if (m_routingTable.LookupRoute(dst, toBroadcast))
-                    {
-                        Ptr<Ipv4Route> route = toBroadcast.GetRoute();
-                        ucb(route, packet, header);
-                    }
-                    else
-                    {
-                        NS_LOG_DEBUG("No route to forward broadcast. Drop packet " << p->GetUid());
-                    }
+                    Ptr<Ipv4Route> route = toBroadcast.GetRoute();
+                    // IP copies the packet on forward, no need to do it here
+                    ucb(route, p, header);
                 }
                 else
                 {
-                    NS_LOG_DEBUG("TTL exceeded. Drop packet " << p->GetUid());
+                    NS_LOG_DEBUG("No route to forward broadcast. Drop packet " << p->GetUid());
                 }
-                return true;
             }
+            else
+            {
+                NS_LOG_DEBUG("TTL exceeded. Drop packet " << p->GetUid());
+            }
+            return true;
         }
     }
 
     // Unicast local delivery
     if (m_ipv4->IsDestinationAddress(dst, iif))
     {
-        UpdateRouteLifeTime(origin, m_activeRouteTimeout);
         RoutingTableEntry toOrigin;
         if (m_routingTable.LookupValidRoute(origin, toOrigin))
         {
-            UpdateRouteLifeTime(toOrigin.GetNextHop(), m_activeRouteTimeout);
+            Time lifetime = GetActiveRouteTimeout(toOrigin.GetNextHop());
+            UpdateRouteLifeTime(origin, lifetime);
+            UpdateRouteLifeTime(toOrigin.GetNextHop(), lifetime);
             m_nb.Update(toOrigin.GetNextHop(), m_activeRouteTimeout);
         }
+        else
+        {
+            UpdateRouteLifeTime(origin, m_activeRouteTimeout);
+        }
         if (lcb.IsNull() == false)
         {
             NS_LOG_LOGIC("Unicast local delivery to " << dst);
@@ -654,11 +1128,12 @@ RoutingProtocol::Forwarding(Ptr<const Packet> p,
     Ipv4Address origin = header.GetSource();
     m_routingTable.Purge();
     RoutingTableEntry toDst;
-    if (m_routingTable.LookupRoute(dst, toDst))
+    if (m_routingTable.LookupLongestPrefixRoute(dst, toDst) ||
+        m_routingTable.LookupRoute(dst, toDst))
     {
         if (toDst.GetFlag() == VALID)
         {
-            Ptr<Ipv4Route> route = toDst.GetRoute();
+            Ptr<Ipv4Route> route = SelectRoute(toDst, p, header, false);
             NS_LOG_LOGIC(route->GetSource() << " forwarding to " << dst << " from " << origin
                                             << " packet " << p->GetUid());
 
@@ -668,25 +1143,35 @@ RoutingProtocol::Forwarding(Ptr<const Packet> p,
              *  path to the destination is updated to be no less than the current
              *  time plus ActiveRouteTimeout.
              */
-            UpdateRouteLifeTime(origin, m_activeRouteTimeout);
-            UpdateRouteLifeTime(dst, m_activeRouteTimeout);
-            UpdateRouteLifeTime(route->GetGateway(), m_activeRouteTimeout);
+            RoutingTableEntry toOrigin;
+            m_routingTable.LookupRoute(origin, toOrigin);
+            Time lifetime = GetActiveRouteTimeout(route->GetGateway());
+            UpdateRouteLifeTime(origin, GetActiveRouteTimeout(toOrigin.GetNextHop()));
+            UpdateRouteLifeTime(toDst.GetDestination(), lifetime);
+            UpdateRouteLifeTime(route->GetGateway(), lifetime);
             /*
              *  Since the route between each originator and destination pair is expected to be
              * symmetric, the Active Route Lifetime for the previous hop, along the reverse path
              * back to the IP source, is also updated to be no less than the current time plus
              * ActiveRouteTimeout
              */
-            RoutingTableEntry toOrigin;
-            m_routingTable.LookupRoute(origin, toOrigin);
-            UpdateRouteLifeTime(toOrigin.GetNextHop(), m_activeRouteTimeout);
+            UpdateRouteLifeTime(toOrigin.GetNextHop(),
+                                GetActiveRouteTimeout(toOrigin.GetNextHop()));
 
             m_nb.Update(route->GetGateway(), m_activeRouteTimeout);
             m_nb.Update(toOrigin.GetNextHop(), m_activeRouteTimeout);
 
+            AttachPiggyback(p, route);
             ucb(route, p, header);
             return true;
         }
+        else if (toDst.GetFlag() == IN_SEARCH && m_localRepair.find(dst) != m_localRepair.end())
+        {
+            NS_LOG_LOGIC("Route to " << dst << " is being repaired, queue packet " << p->GetUid());
+            QueueEntry newEntry(p, header, ucb, ecb);
+            m_queue.Enqueue(newEntry);
+            return true;
+        }
         else
         {
             if (toDst.GetValidSeqNo())
@@ -697,6 +1182,12 @@ RoutingProtocol::Forwarding(Ptr<const Packet> p,
             }
         }
     }
+    if (GetHostedPrefixSize(dst) != 0)
+    {
+        // The subnet is reached through another routing protocol of this border node
+        NS_LOG_LOGIC("Leave packet " << p->GetUid() << " to hosted subnet of " << dst);
+        return false;
+    }
     NS_LOG_LOGIC("route not found to " << dst << ". Send RERR message.");
     NS_LOG_DEBUG("Drop packet " << p->GetUid() << " because no route to forward it.");
     SendRerrWhenNoRouteToForward(dst, 0, origin);
@@ -765,6 +1256,7 @@ RoutingProtocol::NotifyInterfaceUp(uint32_t i)
     socket->SetAllowBroadcast(true);
     socket->SetIpRecvTtl(true);
     m_socketSubnetBroadcastAddresses.insert(std::make_pair(socket, iface));
+    UpdateInterfaceTable();
 
     // Add local broadcast record to the routing table
     Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(iface.GetLocal()));
@@ -797,63 +1289,463 @@ RoutingProtocol::NotifyInterfaceUp(uint32_t i)
 
     mac->TraceConnectWithoutContext("DroppedMpdu",
                                     MakeCallback(&RoutingProtocol::NotifyTxError, this));
+    if (m_enablePreemptiveMaintenance)
+    {
+        mac->TraceConnectWithoutContext("AckedMpdu",
+                                        MakeCallback(&RoutingProtocol::NotifyTxAcked, this));
+        wifi->GetRemoteStationManager()->TraceConnectWithoutContext(
+            "MacTxDataFailed",
+            MakeCallback(&RoutingProtocol::NotifyTxRetry, this));
+    }
+    if (m_enablePreemptiveMaintenance || m_enablePromiscuousLearning || m_enableJitterRssiBias)
+    {
+        wifi->GetPhy()->TraceConnectWithoutContext(
+            "MonitorSnifferRx",
+            MakeCallback(&RoutingProtocol::NotifyRxSignal, this));
+    }
 }
 
 void
 RoutingProtocol::NotifyTxError(WifiMacDropReason reason, Ptr<const WifiMpdu> mpdu)
 {
     m_nb.GetTxErrorCallback()(mpdu->GetHeader());
+    // Salvage once the link break was processed: every route left valid avoids the broken link,
+    // so a salvaged packet is never sent to it again. The RERR is already on its way upstream,
+    // the salvaged packet only saves what was in flight.
+    if (m_enableSalvage && reason == WIFI_MAC_DROP_REACHED_RETRY_LIMIT)
+    {
+        SalvageMpdu(mpdu);
+    }
 }
 
 void
-RoutingProtocol::NotifyInterfaceDown(uint32_t i)
+RoutingProtocol::SalvageMpdu(Ptr<const WifiMpdu> mpdu)
 {
-    NS_LOG_FUNCTION(this << m_ipv4->GetAddress(i, 0).GetLocal());
-
-    // Disable layer 2 link state monitoring (if possible)
-    Ptr<Ipv4L3Protocol> l3 = m_ipv4->GetObject<Ipv4L3Protocol>();
-    Ptr<NetDevice> dev = l3->GetNetDevice(i);
-    Ptr<WifiNetDevice> wifi = dev->GetObject<WifiNetDevice>();
-    if (wifi)
+    const WifiMacHeader& hdr = mpdu->GetHeader();
+    if (!hdr.IsData() || hdr.GetAddr1().IsGroup() || (hdr.IsQosData() && hdr.IsQosAmsdu()))
     {
-        Ptr<WifiMac> mac = wifi->GetMac()->GetObject<AdhocWifiMac>();
-        if (mac)
+        return;
+    }
+    Ptr<Packet> packet = mpdu->GetPacket()->Copy();
+    PiggybackTag piggyback;
+    packet->RemovePacketTag(piggyback);
+    LlcSnapHeader llc;
+    if (packet->RemoveHeader(llc) == 0 || llc.GetType() != Ipv4L3Protocol::PROT_NUMBER)
+    {
+        return;
+    }
+    Ipv4Header header;
+    packet->RemoveHeader(header);
+    Ipv4Address dst = header.GetDestination();
+    if (dst.IsBroadcast() || dst.IsMulticast())
+    {
+        return;
+    }
+    // MADAODV control packets are not salvaged, they are regenerated by the protocol
+    if (header.GetProtocol() == UdpL4Protocol::PROT_NUMBER && header.GetFragmentOffset() == 0)
+    {
+        UdpHeader udpHeader;
+        packet->PeekHeader(udpHeader);
+        if (udpHeader.GetDestinationPort() == MADAODV_PORT)
         {
-            mac->TraceDisconnectWithoutContext("DroppedMpdu",
-                                               MakeCallback(&RoutingProtocol::NotifyTxError, this));
-            m_nb.DelArpCache(l3->GetInterface(i)->GetArpCache());
+            return;
         }
     }
 
-    // Close socket
-    Ptr<Socket> socket = FindSocketWithInterfaceAddress(m_ipv4->GetAddress(i, 0));
-    NS_ASSERT(socket);
-    socket->Close();
-    m_socketAddresses.erase(socket);
-
-    // Close socket
-    socket = FindSubnetBroadcastSocketWithInterfaceAddress(m_ipv4->GetAddress(i, 0));
-    NS_ASSERT(socket);
-    socket->Close();
-    m_socketSubnetBroadcastAddresses.erase(socket);
-
-    if (m_socketAddresses.empty())
+    RoutingTableEntry toDst;
+    if (m_routingTable.LookupValidRoute(dst, toDst))
     {
-        NS_LOG_LOGIC("No madaodv interfaces");
-        m_htimer.Cancel();
-        m_nb.Clear();
-        m_routingTable.Clear();
+        NS_LOG_LOGIC("Salvage packet " << packet->GetUid() << " to " << dst << " via "
+                                       << toDst.GetNextHop());
+        SalvageSend(SelectRoute(toDst, packet, header, false), packet, header);
         return;
     }
-    m_routingTable.DeleteAllRoutesFromInterface(m_ipv4->GetAddress(i, 0));
+    // The source rediscovers the route and an intermediate node may be repairing it; otherwise
+    // the break was reported to the source and the packet is lost as before.
+    if (m_ipv4->GetInterfaceForAddress(header.GetSource()) >= 0 ||
+        m_localRepair.find(dst) != m_localRepair.end())
+    {
+        NS_LOG_LOGIC("Queue salvaged packet " << packet->GetUid() << " to " << dst);
+        DeferredRouteOutput(packet,
+                            header,
+                            MakeCallback(&RoutingProtocol::SalvageSend, this),
+                            MakeCallback(&RoutingProtocol::SalvageDrop, this));
+    }
 }
 
 void
-RoutingProtocol::NotifyAddAddress(uint32_t i, Ipv4InterfaceAddress address)
+RoutingProtocol::SalvageSend(Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header& header)
 {
-    NS_LOG_FUNCTION(this << " interface " << i << " address " << address);
-    Ptr<Ipv4L3Protocol> l3 = m_ipv4->GetObject<Ipv4L3Protocol>();
-    if (!l3->IsUp(i))
+    NS_LOG_FUNCTION(this << p->GetUid() << header.GetDestination());
+    Ptr<Packet> copy = p->Copy();
+    // The tag of the failed transmission was removed, it named the old next hop. A packet sent
+    // from the request queue is already tagged for its new route.
+    AttachPiggyback(copy, route);
+    m_ipv4->GetObject<Ipv4L3Protocol>()->SendWithHeader(copy, header, route);
+}
+
+void
+RoutingProtocol::SalvageDrop(Ptr<const Packet> p, const Ipv4Header& header, Socket::SocketErrno err)
+{
+    NS_LOG_DEBUG("Drop salvaged packet " << p->GetUid() << " to " << header.GetDestination());
+    m_dropTrace(header, p, Ipv4L3Protocol::DROP_ROUTE_ERROR, m_ipv4, 0);
+}
+
+void
+RoutingProtocol::NotifyTxRetry(Mac48Address addr)
+{
+    m_nb.ProcessTxRetry(addr);
+}
+
+void
+RoutingProtocol::NotifyTxAcked(Ptr<const WifiMpdu> mpdu)
+{
+    m_nb.ProcessTxSuccess(mpdu->GetHeader().GetAddr1());
+}
+
+void
+RoutingProtocol::NotifyRxSignal(Ptr<const Packet> packet,
+                                uint16_t channelFreqMhz,
+                                WifiTxVector txVector,
+                                MpduInfo aMpdu,
+                                SignalNoiseDbm signalNoise,
+                                uint16_t staId)
+{
+    bool rssi = m_enablePreemptiveMaintenance || m_enableJitterRssiBias;
+    if (!rssi && !m_enablePromiscuousLearning)
+    {
+        return;
+    }
+    // Only the frames of an A-MPDU need a copy to read their MAC header
+    Ptr<const Packet> frame = packet;
+    if (aMpdu.type != NORMAL_MPDU)
+    {
+        Ptr<Packet> copy = packet->Copy();
+        AmpduSubframeHeader subframe;
+        copy->RemoveHeader(subframe);
+        frame = copy;
+    }
+    WifiMacHeader hdr;
+    if (frame->GetSize() < hdr.GetSerializedSize() || frame->PeekHeader(hdr) == 0 ||
+        !hdr.IsData())
+    {
+        return;
+    }
+    if (rssi)
+    {
+        m_nb.ProcessRxSignal(hdr.GetAddr2(), signalNoise.signal);
+    }
+    // Frames addressed to this node or broadcast reach the routing protocol anyway
+    if (m_enablePromiscuousLearning && !hdr.GetAddr1().IsGroup() &&
+        !(hdr.IsQosData() && hdr.IsQosAmsdu()))
+    {
+        Ptr<Packet> payload = frame->Copy();
+        payload->RemoveHeader(hdr);
+        ProcessOverheard(payload);
+    }
+}
+
+void
+RoutingProtocol::ProcessOverheard(Ptr<Packet> packet)
+{
+    LlcSnapHeader llc;
+    if (packet->RemoveHeader(llc) == 0 || llc.GetType() != Ipv4L3Protocol::PROT_NUMBER)
+    {
+        return;
+    }
+    Ipv4Header header;
+    packet->RemoveHeader(header);
+    if (header.GetProtocol() != UdpL4Protocol::PROT_NUMBER || header.GetFragmentOffset() != 0 ||
+        IsMyOwnAddress(header.GetDestination()) || IsMyOwnAddress(header.GetSource()))
+    {
+        return;
+    }
+    UdpHeader udpHeader;
+    packet->RemoveHeader(udpHeader);
+    if (udpHeader.GetDestinationPort() != MADAODV_PORT)
+    {
+        return;
+    }
+    TypeHeader tHeader(MADAODVTYPE_RREQ);
+    packet->RemoveHeader(tHeader);
+    if (!tHeader.IsValid())
+    {
+        return;
+    }
+    switch (tHeader.Get())
+    {
+    case MADAODVTYPE_RREP: {
+        OverhearReply(packet, header.GetSource());
+        break;
+    }
+    case MADAODVTYPE_RERR: {
+        // The RERR only invalidates the routes of this node through the same transmitter
+        NS_LOG_LOGIC("Overheard RERR from " << header.GetSource());
+        RecvError(packet, header.GetSource());
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void
+RoutingProtocol::OverhearReply(Ptr<Packet> p, Ipv4Address transmitter)
+{
+    RrepHeader rrepHeader;
+    p->RemoveHeader(rrepHeader);
+    Ipv4Address dst = rrepHeader.GetDst();
+    if (dst == rrepHeader.GetOrigin() || dst == transmitter || IsMyOwnAddress(dst))
+    {
+        return;
+    }
+    // The transmitter is heard, but it must also hear this node to be used as next hop
+    RoutingTableEntry toTransmitter;
+    if (!m_routingTable.LookupValidRoute(transmitter, toTransmitter) ||
+        toTransmitter.GetHop() != 1 || m_nb.IsUnidirectional(transmitter))
+    {
+        return;
+    }
+    uint8_t hop = rrepHeader.GetHopCount() + 1;
+    RoutingTableEntry newEntry(/*dev=*/toTransmitter.GetOutputDevice(),
+                               /*dst=*/dst,
+                               /*vSeqNo=*/true,
+                               /*seqNo=*/rrepHeader.GetDstSeqno(),
+                               /*iface=*/toTransmitter.GetInterface(),
+                               /*hops=*/hop,
+                               /*nextHop=*/transmitter,
+                               /*lifetime=*/rrepHeader.GetLifeTime());
+    if (AcceptRoute(newEntry))
+    {
+        NS_LOG_LOGIC("Overheard route to " << dst << " via " << transmitter << ", "
+                                           << (uint16_t)hop << " hops");
+    }
+}
+
+bool
+RoutingProtocol::AcceptRoute(RoutingTableEntry& newEntry)
+{
+    Ipv4Address dst = newEntry.GetDestination();
+    RoutingTableEntry toDst;
+    if (!m_routingTable.LookupRoute(dst, toDst))
+    {
+        m_routingTable.AddRoute(newEntry);
+        return true;
+    }
+    // The same freshness rules as for a RREP received by this node
+    if (toDst.GetValidSeqNo())
+    {
+        int32_t diff = int32_t(newEntry.GetSeqNo()) - int32_t(toDst.GetSeqNo());
+        if (diff < 0 ||
+            (diff == 0 && toDst.GetFlag() == VALID && newEntry.GetHop() >= toDst.GetHop()))
+        {
+            return false;
+        }
+    }
+    // The nodes forwarding through this one still do
+    std::vector<Ipv4Address> precursors;
+    toDst.GetPrecursors(precursors);
+    for (std::vector<Ipv4Address>::const_iterator i = precursors.begin(); i != precursors.end();
+         ++i)
+    {
+        newEntry.InsertPrecursor(*i);
+    }
+    m_routingTable.Update(newEntry);
+    if (toDst.GetFlag() == IN_SEARCH)
+    {
+        // The route ends the discovery this node was running
+        m_addressReqTimer[dst].Cancel();
+        m_addressReqTimer.erase(dst);
+        LocalRepairDone(dst);
+        SendPacketFromQueue(dst, newEntry.GetRoute());
+    }
+    return true;
+}
+
+void
+RoutingProtocol::AdvertTimerExpire()
+{
+    NS_LOG_FUNCTION(this);
+    SendAdvertisement();
+    // Jitter the interval so that the advertisements of several destinations do not collide
+    Time jitter = MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10));
+    m_advertTimer.Schedule(std::max(Time(Seconds(0)), m_advertiseInterval - jitter));
+}
+
+void
+RoutingProtocol::SendAdvertisement()
+{
+    NS_LOG_FUNCTION(this);
+    // The sequence number only changes with the route, the copies of one advertisement are told
+    // apart by its ID
+    m_advertId++;
+    Ptr<Packet> extensions = Create<Packet>();
+    extensions->AddHeader(AdvertisementExtension(m_advertId));
+    for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin();
+         j != m_socketAddresses.end();
+         ++j)
+    {
+        Ptr<Socket> socket = j->first;
+        Ipv4InterfaceAddress iface = j->second;
+        RrepHeader advertHeader(/*prefixSize=*/0,
+                                /*hopCount=*/0,
+                                /*dst=*/iface.GetLocal(),
+                                /*dstSeqNo=*/m_seqNo,
+                                /*origin=*/Ipv4Address::GetBroadcast(),
+                                /*lifetime=*/Time(m_allowedHelloLoss * m_advertiseInterval));
+        Ptr<Packet> packet =
+            CreateControlPacket(advertHeader, MADAODVTYPE_RREP, m_netDiameter, extensions);
+        // Send to all-hosts broadcast if on /32 addr, subnet-directed otherwise
+        Ipv4Address destination;
+        if (iface.GetMask() == Ipv4Mask::GetOnes())
+        {
+            destination = Ipv4Address("255.255.255.255");
+        }
+        else
+        {
+            destination = iface.GetBroadcast();
+        }
+        m_lastBcastTime = Simulator::Now();
+        Time jitter = GetBroadcastJitter();
+        Simulator::Schedule(jitter, &RoutingProtocol::SendTo, this, socket, packet, destination);
+    }
+}
+
+void
+RoutingProtocol::RecvAdvertisement(Ptr<Packet> p,
+                                   RrepHeader& rrepHeader,
+                                   Ipv4Address receiver,
+                                   Ipv4Address sender)
+{
+    Ipv4Address dst = rrepHeader.GetDst();
+    NS_LOG_FUNCTION(this << dst << sender);
+    if (IsMyOwnAddress(dst))
+    {
+        return;
+    }
+    // A route learned over a unidirectional link would not carry any data back
+    RoutingTableEntry toPrev;
+    if (m_routingTable.LookupRoute(sender, toPrev) && toPrev.IsUnidirectional())
+    {
+        NS_LOG_DEBUG("Ignoring route advertisement from node in blacklist");
+        return;
+    }
+    if (m_nb.IsUnidirectional(sender))
+    {
+        NS_LOG_DEBUG("Ignoring route advertisement over unidirectional link from " << sender);
+        return;
+    }
+    // Only the first copy of each advertisement is processed and forwarded
+    AdvertisementExtension advert;
+    if (!PeekExtension(p, MADAODVEXT_ADVERTISEMENT, advert))
+    {
+        NS_LOG_DEBUG("Ignoring route advertisement of " << dst << " without ID");
+        return;
+    }
+    std::map<Ipv4Address, uint32_t>::iterator last = m_advertIds.find(dst);
+    if (last != m_advertIds.end() && int32_t(advert.GetId()) - int32_t(last->second) <= 0)
+    {
+        NS_LOG_DEBUG("Ignoring duplicate route advertisement of " << dst);
+        return;
+    }
+    m_advertIds[dst] = advert.GetId();
+
+    int32_t interface = m_ipv4->GetInterfaceForAddress(receiver);
+    RoutingTableEntry newEntry(/*dev=*/m_ipv4->GetNetDevice(interface),
+                               /*dst=*/dst,
+                               /*vSeqNo=*/true,
+                               /*seqNo=*/rrepHeader.GetDstSeqno(),
+                               /*iface=*/m_ipv4->GetAddress(interface, 0),
+                               /*hops=*/rrepHeader.GetHopCount(),
+                               /*nextHop=*/sender,
+                               /*lifetime=*/rrepHeader.GetLifeTime());
+    RoutingTableEntry toDst;
+    if (!AcceptRoute(newEntry) && m_routingTable.LookupValidRoute(dst, toDst) &&
+        toDst.GetNextHop() == sender && toDst.GetSeqNo() == rrepHeader.GetDstSeqno())
+    {
+        // The same route advertised again, keep it alive
+        toDst.SetLifeTime(std::max(rrepHeader.GetLifeTime(), toDst.GetLifeTime()));
+        m_routingTable.Update(toDst);
+    }
+
+    SocketIpTtlTag tag;
+    p->RemovePacketTag(tag);
+    if (tag.GetTtl() < 2)
+    {
+        NS_LOG_DEBUG("TTL exceeded. Drop route advertisement of " << dst);
+        return;
+    }
+    BroadcastRequest(CreateControlPacket(rrepHeader, MADAODVTYPE_RREP, tag.GetTtl() - 1, p),
+                     true,
+                     sender);
+}
+
+void
+RoutingProtocol::NotifyInterfaceDown(uint32_t i)
+{
+    NS_LOG_FUNCTION(this << m_ipv4->GetAddress(i, 0).GetLocal());
+
+    // Disable layer 2 link state monitoring (if possible)
+    Ptr<Ipv4L3Protocol> l3 = m_ipv4->GetObject<Ipv4L3Protocol>();
+    Ptr<NetDevice> dev = l3->GetNetDevice(i);
+    Ptr<WifiNetDevice> wifi = dev->GetObject<WifiNetDevice>();
+    if (wifi)
+    {
+        Ptr<WifiMac> mac = wifi->GetMac()->GetObject<AdhocWifiMac>();
+        if (mac)
+        {
+            mac->TraceDisconnectWithoutContext("DroppedMpdu",
+                                               MakeCallback(&RoutingProtocol::NotifyTxError, this));
+            if (m_enablePreemptiveMaintenance)
+            {
+                mac->TraceDisconnectWithoutContext(
+                    "AckedMpdu",
+                    MakeCallback(&RoutingProtocol::NotifyTxAcked, this));
+                wifi->GetRemoteStationManager()->TraceDisconnectWithoutContext(
+                    "MacTxDataFailed",
+                    MakeCallback(&RoutingProtocol::NotifyTxRetry, this));
+            }
+            if (m_enablePreemptiveMaintenance || m_enablePromiscuousLearning ||
+                m_enableJitterRssiBias)
+            {
+                wifi->GetPhy()->TraceDisconnectWithoutContext(
+                    "MonitorSnifferRx",
+                    MakeCallback(&RoutingProtocol::NotifyRxSignal, this));
+            }
+            m_nb.DelArpCache(l3->GetInterface(i)->GetArpCache());
+        }
+    }
+
+    // Close socket
+    Ptr<Socket> socket = FindSocketWithInterfaceAddress(m_ipv4->GetAddress(i, 0));
+    NS_ASSERT(socket);
+    socket->Close();
+    m_socketAddresses.erase(socket);
+
+    // Close socket
+    socket = FindSubnetBroadcastSocketWithInterfaceAddress(m_ipv4->GetAddress(i, 0));
+    NS_ASSERT(socket);
+    socket->Close();
+    m_socketSubnetBroadcastAddresses.erase(socket);
+    UpdateInterfaceTable();
+
+    if (m_socketAddresses.empty())
+    {
+        NS_LOG_LOGIC("No madaodv interfaces");
+        m_htimer.Cancel();
+        m_nb.Clear();
+        m_routingTable.Clear();
+        return;
+    }
+    m_routingTable.DeleteAllRoutesFromInterface(m_ipv4->GetAddress(i, 0));
+}
+
+void
+RoutingProtocol::NotifyAddAddress(uint32_t i, Ipv4InterfaceAddress address)
+{
+    NS_LOG_FUNCTION(this << " interface " << i << " address " << address);
+    Ptr<Ipv4L3Protocol> l3 = m_ipv4->GetObject<Ipv4L3Protocol>();
+    if (!l3->IsUp(i))
     {
         return;
     }
@@ -886,6 +1778,7 @@ RoutingProtocol::NotifyAddAddress(uint32_t i, Ipv4InterfaceAddress address)
             socket->SetAllowBroadcast(true);
             socket->SetIpRecvTtl(true);
             m_socketSubnetBroadcastAddresses.insert(std::make_pair(socket, iface));
+            UpdateInterfaceTable();
 
             // Add local broadcast record to the routing table
             Ptr<NetDevice> dev =
@@ -923,7 +1816,7 @@ RoutingProtocol::NotifyRemoveAddress(uint32_t i, Ipv4InterfaceAddress address)
         if (unicastSocket)
         {
             unicastSocket->Close();
-            m_socketAddresses.erase(unicastSocket);
+            m_socketSubnetBroadcastAddresses.erase(unicastSocket);
         }
 
         Ptr<Ipv4L3Protocol> l3 = m_ipv4->GetObject<Ipv4L3Protocol>();
@@ -965,6 +1858,7 @@ RoutingProtocol::NotifyRemoveAddress(uint32_t i, Ipv4InterfaceAddress address)
                                  /*lifetime=*/Simulator::GetMaximumSimulationTime());
             m_routingTable.AddRoute(rt);
         }
+        UpdateInterfaceTable();
         if (m_socketAddresses.empty())
         {
             NS_LOG_LOGIC("No madaodv interfaces");
@@ -980,16 +1874,44 @@ RoutingProtocol::NotifyRemoveAddress(uint32_t i, Ipv4InterfaceAddress address)
     }
 }
 
+void
+RoutingProtocol::UpdateInterfaceTable()
+{
+    NS_LOG_FUNCTION(this);
+    m_interfaces.assign(m_ipv4->GetNInterfaces(), InterfaceState());
+    for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin();
+         j != m_socketAddresses.end();
+         ++j)
+    {
+        int32_t interface = m_ipv4->GetInterfaceForAddress(j->second.GetLocal());
+        if (interface >= 0)
+        {
+            m_interfaces[interface].socket = j->first;
+            m_interfaces[interface].address = j->second;
+        }
+    }
+    for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j =
+             m_socketSubnetBroadcastAddresses.begin();
+         j != m_socketSubnetBroadcastAddresses.end();
+         ++j)
+    {
+        int32_t interface = m_ipv4->GetInterfaceForAddress(j->second.GetLocal());
+        if (interface >= 0)
+        {
+            m_interfaces[interface].subnetBroadcastSocket = j->first;
+        }
+    }
+}
+
 bool
 RoutingProtocol::IsMyOwnAddress(Ipv4Address src)
 {
     NS_LOG_FUNCTION(this << src);
-    for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin();
-         j != m_socketAddresses.end();
+    for (std::vector<InterfaceState>::const_iterator j = m_interfaces.begin();
+         j != m_interfaces.end();
          ++j)
     {
-        Ipv4InterfaceAddress iface = j->second;
-        if (src == iface.GetLocal())
+        if (j->socket && src == j->address.GetLocal())
         {
             return true;
         }
@@ -1049,6 +1971,24 @@ void
 RoutingProtocol::SendRequest(Ipv4Address dst)
 {
     NS_LOG_FUNCTION(this << dst);
+    // A RREQ carries the QoS bounds of a single destination
+    if (m_rreqAggregationWindow.IsStrictlyPositive() &&
+        m_qosRequirements.find(dst) == m_qosRequirements.end())
+    {
+        // Collect the destinations looked for during the window into a single flood
+        if (std::find(m_aggregatedRequests.begin(), m_aggregatedRequests.end(), dst) ==
+            m_aggregatedRequests.end())
+        {
+            m_aggregatedRequests.push_back(dst);
+        }
+        if (!m_aggregationEvent.IsRunning())
+        {
+            m_aggregationEvent = Simulator::Schedule(m_rreqAggregationWindow,
+                                                     &RoutingProtocol::SendAggregatedRequest,
+                                                     this);
+        }
+        return;
+    }
     // A node SHOULD NOT originate more than RREQ_RATELIMIT RREQ messages per second.
     if (m_rreqCount == m_rreqRateLimit)
     {
@@ -1062,23 +2002,91 @@ RoutingProtocol::SendRequest(Ipv4Address dst)
     {
         m_rreqCount++;
     }
-    // Create RREQ header
     RreqHeader rreqHeader;
-    rreqHeader.SetDst(dst);
-
-    RoutingTableEntry rt;
-    // Using the Hop field in Routing Table to manage the expanding ring search
-    uint16_t ttl = m_ttlStart;
-    if (m_routingTable.LookupRoute(dst, rt))
+    uint16_t ttl = PrepareRequest(dst, rreqHeader);
+    if (!BroadcastNewRequest(rreqHeader, ttl))
     {
-        if (rt.GetFlag() != IN_SEARCH)
-        {
-            ttl = std::min<uint16_t>(rt.GetHop() + m_ttlIncrement, m_netDiameter);
-        }
-        else
-        {
-            ttl = rt.GetHop() + m_ttlIncrement;
-            if (ttl > m_ttlThreshold)
+        // No retry can meet the QoS bounds either, fail the discovery right away
+        NS_LOG_DEBUG("QoS bounds to " << dst << " cannot be met. Drop all packets with dst "
+                                      << dst);
+        m_addressReqTimer.erase(dst);
+        m_routingTable.DeleteRoute(dst);
+        m_queue.DropPacketWithDst(dst);
+        RouteStateChanged(dst, false);
+        return;
+    }
+    ScheduleRreqRetry(dst);
+}
+
+void
+RoutingProtocol::SendAggregatedRequest()
+{
+    NS_LOG_FUNCTION(this);
+    while (!m_aggregatedRequests.empty())
+    {
+        // A node SHOULD NOT originate more than RREQ_RATELIMIT RREQ messages per second.
+        if (m_rreqCount == m_rreqRateLimit)
+        {
+            m_aggregationEvent =
+                Simulator::Schedule(m_rreqRateLimitTimer.GetDelayLeft() + MicroSeconds(100),
+                                    &RoutingProtocol::SendAggregatedRequest,
+                                    this);
+            return;
+        }
+        m_rreqCount++;
+
+        // The first destination goes to the fixed part of the RREQ, the following ones to the
+        // multi-destination extension
+        std::size_t count = std::min<std::size_t>(m_aggregatedRequests.size(),
+                                                  1 + MultiDestinationExtension::MAX_DESTINATIONS);
+        std::vector<Ipv4Address> dsts(m_aggregatedRequests.begin(),
+                                      m_aggregatedRequests.begin() + count);
+        m_aggregatedRequests.erase(m_aggregatedRequests.begin(),
+                                   m_aggregatedRequests.begin() + count);
+
+        RreqHeader rreqHeader;
+        uint16_t ttl = PrepareRequest(dsts.front(), rreqHeader);
+        Ptr<Packet> extensions;
+        if (dsts.size() > 1)
+        {
+            MultiDestinationExtension multi;
+            for (std::size_t i = 1; i < dsts.size(); ++i)
+            {
+                RreqHeader other;
+                ttl = std::max(ttl, PrepareRequest(dsts[i], other));
+                multi.AddDestination(dsts[i], other.GetDstSeqno(), other.GetUnknownSeqno());
+            }
+            extensions = Create<Packet>();
+            extensions->AddHeader(multi);
+        }
+        NS_LOG_LOGIC("Aggregated RREQ for " << dsts.size() << " destinations");
+        BroadcastNewRequest(rreqHeader, ttl, extensions);
+        for (std::vector<Ipv4Address>::const_iterator i = dsts.begin(); i != dsts.end(); ++i)
+        {
+            ScheduleRreqRetry(*i);
+        }
+    }
+}
+
+uint16_t
+RoutingProtocol::PrepareRequest(Ipv4Address dst, RreqHeader& rreqHeader)
+{
+    // Create RREQ header
+    rreqHeader.SetDst(dst);
+
+    RoutingTableEntry rt;
+    // Using the Hop field in Routing Table to manage the expanding ring search
+    uint16_t ttl = m_ttlStart;
+    if (m_routingTable.LookupRoute(dst, rt))
+    {
+        if (rt.GetFlag() != IN_SEARCH)
+        {
+            ttl = std::min<uint16_t>(rt.GetHop() + m_ttlIncrement, m_netDiameter);
+        }
+        else
+        {
+            ttl = rt.GetHop() + m_ttlIncrement;
+            if (ttl > m_ttlThreshold)
             {
                 ttl = m_netDiameter;
             }
@@ -1125,16 +2133,68 @@ RoutingProtocol::SendRequest(Ipv4Address dst)
     {
         rreqHeader.SetGratuitousRrep(true);
     }
-    if (m_destinationOnly)
+    // Only the destination knows that the whole path met the QoS bounds
+    if (m_destinationOnly || m_qosRequirements.find(dst) != m_qosRequirements.end())
     {
         rreqHeader.SetDestinationOnly(true);
     }
+    return ttl;
+}
+
+bool
+RoutingProtocol::BroadcastNewRequest(RreqHeader& rreqHeader,
+                                     uint16_t ttl,
+                                     Ptr<const Packet> extensions)
+{
+    NS_LOG_FUNCTION(this << rreqHeader.GetDst() << ttl);
+    // The first hop is the one of this node, keep the interfaces which meet the QoS bounds
+    std::map<Ipv4Address, QosExtension>::const_iterator qos =
+        m_qosRequirements.find(rreqHeader.GetDst());
+    std::map<Ipv4Address, QosExtension> qosBounds;
+    if (qos != m_qosRequirements.end())
+    {
+        for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j =
+                 m_socketAddresses.begin();
+             j != m_socketAddresses.end();
+             ++j)
+        {
+            QosExtension bounds = qos->second;
+            if (ApplyQos(bounds, j->second.GetLocal()))
+            {
+                qosBounds[j->second.GetLocal()] = bounds;
+            }
+            else
+            {
+                NS_LOG_DEBUG("QoS bounds to " << rreqHeader.GetDst() << " cannot be met on "
+                                              << j->second.GetLocal());
+            }
+        }
+        if (qosBounds.empty())
+        {
+            return false;
+        }
+    }
 
     m_seqNo++;
     rreqHeader.SetOriginSeqno(m_seqNo);
     m_requestId++;
     rreqHeader.SetId(m_requestId);
 
+    if (m_enablePathAccumulation)
+    {
+        // The path starts empty, the originator is in the fixed part
+        Ptr<Packet> withPath = extensions ? extensions->Copy() : Create<Packet>();
+        withPath->AddHeader(PathExtension());
+        extensions = withPath;
+    }
+    if (m_enableLoadAwareness)
+    {
+        // The queue of the originator is on every route, only the forwarders are counted
+        Ptr<Packet> withLoad = extensions ? extensions->Copy() : Create<Packet>();
+        withLoad->AddHeader(LoadExtension());
+        extensions = withLoad;
+    }
+
     // Send RREQ as subnet directed broadcast from each interface used by madaodv
     for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin();
          j != m_socketAddresses.end();
@@ -1146,13 +2206,21 @@ RoutingProtocol::SendRequest(Ipv4Address dst)
         rreqHeader.SetOrigin(iface.GetLocal());
         m_rreqIdCache.IsDuplicate(iface.GetLocal(), m_requestId);
 
-        Ptr<Packet> packet = Create<Packet>();
-        SocketIpTtlTag tag;
-        tag.SetTtl(ttl);
-        packet->AddPacketTag(tag);
-        packet->AddHeader(rreqHeader);
-        TypeHeader tHeader(MADAODVTYPE_RREQ);
-        packet->AddHeader(tHeader);
+        Ptr<const Packet> ifaceExtensions = extensions;
+        if (qos != m_qosRequirements.end())
+        {
+            std::map<Ipv4Address, QosExtension>::const_iterator bounds =
+                qosBounds.find(iface.GetLocal());
+            if (bounds == qosBounds.end())
+            {
+                continue;
+            }
+            Ptr<Packet> withQos = extensions ? extensions->Copy() : Create<Packet>();
+            withQos->AddHeader(bounds->second);
+            ifaceExtensions = withQos;
+        }
+        Ptr<Packet> packet =
+            CreateControlPacket(rreqHeader, MADAODVTYPE_RREQ, ttl, ifaceExtensions);
         // Send to all-hosts broadcast if on /32 addr, subnet-directed otherwise
         Ipv4Address destination;
         if (iface.GetMask() == Ipv4Mask::GetOnes())
@@ -1165,14 +2233,221 @@ RoutingProtocol::SendRequest(Ipv4Address dst)
         }
         NS_LOG_DEBUG("Send RREQ with id " << rreqHeader.GetId() << " to socket");
         m_lastBcastTime = Simulator::Now();
-        Simulator::Schedule(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))),
+        Simulator::Schedule(GetBroadcastJitter(),
                             &RoutingProtocol::SendTo,
                             this,
                             socket,
                             packet,
                             destination);
     }
-    ScheduleRreqRetry(dst);
+    return true;
+}
+
+void
+RoutingProtocol::LinkWeak(Ipv4Address nextHop)
+{
+    NS_LOG_FUNCTION(this << nextHop);
+    std::map<Ipv4Address, uint32_t> routes;
+    m_routingTable.GetListOfDestinationWithNextHop(nextHop, routes);
+    for (std::map<Ipv4Address, uint32_t>::const_iterator i = routes.begin(); i != routes.end();
+         ++i)
+    {
+        if (i->first != nextHop)
+        {
+            PreemptiveRequest(i->first);
+        }
+    }
+}
+
+void
+RoutingProtocol::PreemptiveRequest(Ipv4Address dst)
+{
+    NS_LOG_FUNCTION(this << dst);
+    RoutingTableEntry toDst;
+    // A discovery or a local repair of the route is already running
+    if (!m_routingTable.LookupValidRoute(dst, toDst) ||
+        m_addressReqTimer.find(dst) != m_addressReqTimer.end())
+    {
+        return;
+    }
+    std::map<Ipv4Address, Time>::iterator i = m_preemptiveHoldDown.find(dst);
+    if ((i != m_preemptiveHoldDown.end() && i->second > Simulator::Now()) ||
+        m_rreqCount >= m_rreqRateLimit)
+    {
+        return;
+    }
+    m_rreqCount++;
+    m_preemptiveHoldDown[dst] = Simulator::Now() + m_pathDiscoveryTime;
+
+    /*
+     * The route stays valid and in use. The RREQ asks for a fresher sequence number so that only
+     * the destination, or nodes which heard from it since, answer; a RREP updates the route once
+     * it arrives.
+     */
+    RreqHeader rreqHeader;
+    rreqHeader.SetDst(dst);
+    if (toDst.GetValidSeqNo())
+    {
+        rreqHeader.SetDstSeqno(toDst.GetSeqNo() + 1);
+    }
+    else
+    {
+        rreqHeader.SetUnknownSeqno(true);
+    }
+    uint16_t ttl = std::min<uint16_t>(toDst.GetHop() + m_localAddTtl, m_netDiameter);
+    NS_LOG_LOGIC("Background discovery of route to " << dst << " with ttl " << ttl);
+    BroadcastNewRequest(rreqHeader, ttl);
+}
+
+bool
+RoutingProtocol::IsRepairable(const RoutingTableEntry& rt) const
+{
+    // Only routes used to forward traffic of other nodes are repaired, a source rediscovers
+    // its own routes anyway
+    return m_enableLocalRepair && rt.GetFlag() == VALID && rt.GetValidSeqNo() &&
+           !rt.IsPrecursorListEmpty() && rt.GetHop() <= m_maxRepairTtl;
+}
+
+bool
+RoutingProtocol::LocalRepair(Ipv4Address dst)
+{
+    NS_LOG_FUNCTION(this << dst);
+    RoutingTableEntry toDst;
+    // The RREQ is counted as soon as the rate limit is checked, so that the repairs started for
+    // one link break never exceed RreqRateLimit
+    if (!m_routingTable.LookupRoute(dst, toDst) || !IsRepairable(toDst) ||
+        m_rreqCount >= m_rreqRateLimit)
+    {
+        return false;
+    }
+    m_rreqCount++;
+
+    LocalRepairState& state = m_localRepair[dst];
+    state.hops = toDst.GetHop();
+    toDst.GetPrecursors(state.precursors);
+
+    /*
+     * To repair the link break, the node increments the sequence number for the destination and
+     * then broadcasts a RREQ for that destination. The TTL of the RREQ is the last known hop count
+     * to the destination plus LOCAL_ADD_TTL.
+     */
+    uint16_t ttl = std::min<uint16_t>(toDst.GetHop() + m_localAddTtl, m_netDiameter);
+    Time timeout = 2 * m_nodeTraversalTime * (ttl + m_timeoutBuffer);
+    toDst.SetSeqNo(toDst.GetSeqNo() + 1);
+    toDst.SetFlag(IN_SEARCH);
+    toDst.SetLifeTime(timeout);
+    m_routingTable.Update(toDst);
+
+    RreqHeader rreqHeader;
+    rreqHeader.SetDst(dst);
+    rreqHeader.SetDstSeqno(toDst.GetSeqNo());
+    BroadcastNewRequest(rreqHeader, ttl);
+
+    if (m_addressReqTimer.find(dst) == m_addressReqTimer.end())
+    {
+        Timer timer(Timer::CANCEL_ON_DESTROY);
+        m_addressReqTimer[dst] = timer;
+    }
+    m_addressReqTimer[dst].SetFunction(&RoutingProtocol::LocalRepairTimerExpire, this);
+    m_addressReqTimer[dst].Cancel();
+    m_addressReqTimer[dst].SetArguments(dst);
+    m_addressReqTimer[dst].Schedule(timeout);
+    NS_LOG_LOGIC("Local repair of route to " << dst << " with ttl " << ttl);
+    return true;
+}
+
+void
+RoutingProtocol::LocalRepairTimerExpire(Ipv4Address dst)
+{
+    NS_LOG_FUNCTION(this << dst);
+    m_addressReqTimer.erase(dst);
+    std::map<Ipv4Address, LocalRepairState>::iterator i = m_localRepair.find(dst);
+    if (i == m_localRepair.end())
+    {
+        return;
+    }
+    RoutingTableEntry toDst;
+    if (m_routingTable.LookupValidRoute(dst, toDst))
+    {
+        LocalRepairDone(dst);
+        SendPacketFromQueue(dst, toDst.GetRoute());
+        return;
+    }
+    std::vector<Ipv4Address> precursors = i->second.precursors;
+    m_localRepair.erase(i);
+
+    // The repair failed: drop the buffered packets and report the break to the precursors
+    NS_LOG_DEBUG("Local repair of route to " << dst << " failed");
+    m_queue.DropPacketWithDst(dst);
+    if (!m_routingTable.LookupRoute(dst, toDst))
+    {
+        return;
+    }
+    toDst.Invalidate(m_deletePeriod);
+    m_routingTable.Update(toDst);
+    RerrHeader rerrHeader;
+    rerrHeader.AddUnDestination(dst, toDst.GetSeqNo());
+    SendRerrMessage(CreateControlPacket(rerrHeader, MADAODVTYPE_RERR, 1), precursors);
+}
+
+void
+RoutingProtocol::LocalRepairDone(Ipv4Address dst)
+{
+    NS_LOG_FUNCTION(this << dst);
+    std::map<Ipv4Address, LocalRepairState>::iterator i = m_localRepair.find(dst);
+    if (i == m_localRepair.end())
+    {
+        return;
+    }
+    LocalRepairState state = i->second;
+    m_localRepair.erase(i);
+
+    RoutingTableEntry toDst;
+    if (!m_routingTable.LookupValidRoute(dst, toDst))
+    {
+        return;
+    }
+    // The new route replaced the broken one, keep forwarding for the same precursors
+    for (std::vector<Ipv4Address>::const_iterator j = state.precursors.begin();
+         j != state.precursors.end();
+         ++j)
+    {
+        toDst.InsertPrecursor(*j);
+    }
+    m_routingTable.Update(toDst);
+
+    /*
+     * If the hop count of the newly determined route to the destination is greater than the hop
+     * count of the previously known route, the node issues a RERR with the 'N' flag set, so
+     * that the source may look for a shorter route.
+     */
+    if (toDst.GetHop() > state.hops)
+    {
+        RerrHeader rerrHeader;
+        rerrHeader.SetNoDelete(true);
+        rerrHeader.AddUnDestination(dst, toDst.GetSeqNo());
+        SendRerrMessage(CreateControlPacket(rerrHeader, MADAODVTYPE_RERR, 1), state.precursors);
+    }
+}
+
+Ptr<Packet>
+RoutingProtocol::CreateControlPacket(const Header& header,
+                                     MessageType type,
+                                     uint8_t ttl,
+                                     Ptr<const Packet> extensions) const
+{
+    // Start from a new packet so that every control message gets its own UID
+    Ptr<Packet> packet = Create<Packet>();
+    if (extensions)
+    {
+        packet->AddAtEnd(extensions);
+    }
+    SocketIpTtlTag tag;
+    tag.SetTtl(ttl);
+    packet->AddPacketTag(tag);
+    packet->AddHeader(header);
+    packet->AddHeader(TypeHeader(type));
+    return packet;
 }
 
 void
@@ -1346,9 +2621,19 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
             return;
         }
     }
+    // The neighbor advertised in its hellos that it does not hear this node, a RREP sent back to
+    // it would be lost
+    if (m_nb.IsUnidirectional(src))
+    {
+        NS_LOG_DEBUG("Ignoring RREQ over unidirectional link from " << src);
+        return;
+    }
 
     uint32_t id = rreqHeader.GetId();
     Ipv4Address origin = rreqHeader.GetOrigin();
+    // The load of the forwarders the RREQ went through
+    LoadExtension load;
+    bool hasLoad = m_enableLoadAwareness && PeekExtension(p, MADAODVEXT_LOAD, load);
 
     /*
      *  Node checks to determine whether it has received a RREQ with the same Originator IP Address
@@ -1358,6 +2643,15 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
     if (m_rreqIdCache.IsDuplicate(origin, id))
     {
         NS_LOG_DEBUG("Ignoring RREQ due to duplicate");
+        RecvDuplicateRequest(origin, id, src);
+        if (m_enableMultipath)
+        {
+            RecvAlternateRequest(rreqHeader, receiver, src);
+        }
+        if (m_rreqHoldTime.IsStrictlyPositive())
+        {
+            RecvBetterRequest(rreqHeader, receiver, src, load.GetLoad());
+        }
         return;
     }
 
@@ -1376,43 +2670,17 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
      *  5. the Lifetime is set to be the maximum of (ExistingLifetime, MinimalLifetime), where
      *     MinimalLifetime = current time + 2*NetTraversalTime - 2*HopCount*NodeTraversalTime
      */
-    RoutingTableEntry toOrigin;
-    if (!m_routingTable.LookupRoute(origin, toOrigin))
+    UpdateReverseRoute(rreqHeader, receiver, src);
+    if (m_rreqHoldTime.IsStrictlyPositive())
     {
-        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
-        RoutingTableEntry newEntry(
-            /*dev=*/dev,
-            /*dst=*/origin,
-            /*vSeqNo=*/true,
-            /*seqNo=*/rreqHeader.GetOriginSeqno(),
-            /*iface=*/m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0),
-            /*hops=*/hop,
-            /*nextHop=*/src,
-            /*lifetime=*/Time((2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime)));
-        m_routingTable.AddRoute(newEntry);
-    }
-    else
-    {
-        if (toOrigin.GetValidSeqNo())
-        {
-            if (int32_t(rreqHeader.GetOriginSeqno()) - int32_t(toOrigin.GetSeqNo()) > 0)
-            {
-                toOrigin.SetSeqNo(rreqHeader.GetOriginSeqno());
-            }
-        }
-        else
-        {
-            toOrigin.SetSeqNo(rreqHeader.GetOriginSeqno());
-        }
-        toOrigin.SetValidSeqNo(true);
-        toOrigin.SetNextHop(src);
-        toOrigin.SetOutputDevice(m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver)));
-        toOrigin.SetInterface(m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0));
-        toOrigin.SetHop(hop);
-        toOrigin.SetLifeTime(std::max(Time(2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime),
-                                      toOrigin.GetLifeTime()));
-        m_routingTable.Update(toOrigin);
-        // m_nb.Update (src, Time (AllowedHelloLoss * HelloInterval));
+        HeldRreq& held = m_heldRreq[std::make_pair(origin, id)];
+        held.cost = ReverseRouteCost(hop, src, load.GetLoad());
+        held.replyPending = false;
+        held.event = Simulator::Schedule(m_rreqHoldTime,
+                                         &RoutingProtocol::HeldRequestExpire,
+                                         this,
+                                         origin,
+                                         id);
     }
 
     RoutingTableEntry toNeighbor;
@@ -1448,40 +2716,370 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
                           << static_cast<uint32_t>(rreqHeader.GetHopCount()) << " ID "
                           << rreqHeader.GetId() << " to destination " << rreqHeader.GetDst());
 
-    //  A node generates a RREP if either:
-    //  (i)  it is itself the destination,
-    if (IsMyOwnAddress(rreqHeader.GetDst()))
+    PathExtension path;
+    bool hasPath = m_enablePathAccumulation && PeekExtension(p, MADAODVEXT_PATH, path);
+    if (hasPath)
     {
-        m_routingTable.LookupRoute(origin, toOrigin);
-        NS_LOG_DEBUG("Send reply since I am the destination");
-        SendReply(rreqHeader, toOrigin);
-        return;
+        LearnPath(path, src, receiver);
     }
-    /*
-     * (ii) or it has an active route to the destination, the destination sequence number in the
-     * node's existing route table entry for the destination is valid and greater than or equal to
-     * the Destination Sequence Number of the RREQ, and the "destination only" flag is NOT set.
-     */
-    RoutingTableEntry toDst;
-    Ipv4Address dst = rreqHeader.GetDst();
-    if (m_routingTable.LookupRoute(dst, toDst))
+    QosExtension qos;
+    bool hasQos = PeekExtension(p, MADAODVEXT_QOS, qos);
+
+    // The destinations looked for: the one of the fixed part and, if the RREQ aggregates several
+    // discoveries, those of the multi-destination extension
+    std::vector<MultiDestinationExtension::Destination> targets(1);
+    targets[0].dst = rreqHeader.GetDst();
+    targets[0].seqNo = rreqHeader.GetDstSeqno();
+    targets[0].unknownSeqNo = rreqHeader.GetUnknownSeqno();
+    MultiDestinationExtension multi;
+    if (PeekExtension(p, MADAODVEXT_MULTI_DESTINATION, multi))
     {
-        /*
-         * Drop RREQ, This node RREP will make a loop.
-         */
-        if (toDst.GetNextHop() == src)
+        targets.insert(targets.end(),
+                       multi.GetDestinations().begin(),
+                       multi.GetDestinations().end());
+    }
+
+    // Each destination is answered separately, the RREQ goes on for the others
+    std::vector<MultiDestinationExtension::Destination> remaining;
+    for (std::vector<MultiDestinationExtension::Destination>::const_iterator i = targets.begin();
+         i != targets.end();
+         ++i)
+    {
+        RreqHeader request = rreqHeader;
+        request.SetDst(i->dst);
+        request.SetDstSeqno(i->seqNo);
+        request.SetUnknownSeqno(i->unknownSeqNo);
+        if (!AnswerRequest(request, src))
         {
-            NS_LOG_DEBUG("Drop RREQ from " << src << ", dest next hop " << toDst.GetNextHop());
-            return;
+            MultiDestinationExtension::Destination d;
+            d.dst = request.GetDst();
+            d.seqNo = request.GetDstSeqno();
+            d.unknownSeqNo = request.GetUnknownSeqno();
+            remaining.push_back(d);
         }
-        /*
-         * The Destination Sequence number for the requested destination is set to the maximum of
-         * the corresponding value received in the RREQ message, and the destination sequence value
-         * currently maintained by the node for the requested destination. However, the forwarding
-         * node MUST NOT modify its maintained value for the destination sequence number, even if
-         * the value received in the incoming RREQ is larger than the value currently maintained by
-         * the forwarding node.
-         */
+    }
+    if (remaining.empty())
+    {
+        return;
+    }
+
+    SocketIpTtlTag tag;
+    p->RemovePacketTag(tag);
+    if (tag.GetTtl() < 2)
+    {
+        NS_LOG_DEBUG("TTL exceeded. Drop RREQ origin " << src << " destination "
+                                                       << remaining.front().dst);
+        return;
+    }
+    if (hasQos && !ApplyQos(qos, receiver))
+    {
+        NS_LOG_DEBUG("QoS bounds cannot be met. Drop RREQ origin " << origin << " destination "
+                                                                   << remaining.front().dst);
+        return;
+    }
+
+    rreqHeader.SetDst(remaining.front().dst);
+    rreqHeader.SetDstSeqno(remaining.front().seqNo);
+    rreqHeader.SetUnknownSeqno(remaining.front().unknownSeqNo);
+    Ptr<Packet> extensions = Create<Packet>();
+    if (remaining.size() > 1)
+    {
+        MultiDestinationExtension rest;
+        for (std::size_t i = 1; i < remaining.size(); ++i)
+        {
+            rest.AddDestination(remaining[i].dst, remaining[i].seqNo, remaining[i].unknownSeqNo);
+        }
+        extensions->AddHeader(rest);
+    }
+    if (hasPath && ExtendPath(path, receiver))
+    {
+        extensions->AddHeader(path);
+    }
+    if (hasLoad)
+    {
+        load.SetLoad(load.GetLoad() + GetQueueLoad(receiver));
+        extensions->AddHeader(load);
+    }
+    if (hasQos)
+    {
+        extensions->AddHeader(qos);
+    }
+    ForwardRequest(rreqHeader, tag.GetTtl() - 1, src, extensions);
+}
+
+void
+RoutingProtocol::UpdateReverseRoute(const RreqHeader& rreqHeader,
+                                    Ipv4Address receiver,
+                                    Ipv4Address src)
+{
+    Ipv4Address origin = rreqHeader.GetOrigin();
+    uint8_t hop = rreqHeader.GetHopCount();
+    RoutingTableEntry toOrigin;
+    if (!m_routingTable.LookupRoute(origin, toOrigin))
+    {
+        Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver));
+        RoutingTableEntry newEntry(
+            /*dev=*/dev,
+            /*dst=*/origin,
+            /*vSeqNo=*/true,
+            /*seqNo=*/rreqHeader.GetOriginSeqno(),
+            /*iface=*/m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0),
+            /*hops=*/hop,
+            /*nextHop=*/src,
+            /*lifetime=*/Time((2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime)));
+        m_routingTable.AddRoute(newEntry);
+    }
+    else
+    {
+        if (toOrigin.GetValidSeqNo())
+        {
+            if (int32_t(rreqHeader.GetOriginSeqno()) - int32_t(toOrigin.GetSeqNo()) > 0)
+            {
+                toOrigin.SetSeqNo(rreqHeader.GetOriginSeqno());
+            }
+        }
+        else
+        {
+            toOrigin.SetSeqNo(rreqHeader.GetOriginSeqno());
+        }
+        toOrigin.SetValidSeqNo(true);
+        toOrigin.SetNextHop(src);
+        toOrigin.SetOutputDevice(m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(receiver)));
+        toOrigin.SetInterface(m_ipv4->GetAddress(m_ipv4->GetInterfaceForAddress(receiver), 0));
+        toOrigin.SetHop(hop);
+        toOrigin.SetLifeTime(std::max(Time(2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime),
+                                      toOrigin.GetLifeTime()));
+        m_routingTable.Update(toOrigin);
+    }
+}
+
+uint32_t
+RoutingProtocol::ReverseRouteCost(uint8_t hops, Ipv4Address src, uint32_t load) const
+{
+    // A link predicted to fail counts as one more hop
+    return (hops + (m_nb.IsLinkWeak(src) ? 1 : 0)) * m_loadPerHop + load;
+}
+
+uint32_t
+RoutingProtocol::GetQueueLoad(Ipv4Address iface) const
+{
+    Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(iface));
+    Ptr<WifiNetDevice> wifi = dev->GetObject<WifiNetDevice>();
+    if (!wifi)
+    {
+        return 0;
+    }
+    Ptr<WifiMac> mac = wifi->GetMac();
+    if (!mac->GetQosSupported())
+    {
+        return mac->GetTxopQueue(AC_BE_NQOS)->GetNPackets();
+    }
+    uint32_t load = 0;
+    for (uint8_t ac = AC_BE; ac <= AC_VO; ++ac)
+    {
+        load += mac->GetTxopQueue(static_cast<AcIndex>(ac))->GetNPackets();
+    }
+    return load;
+}
+
+uint64_t
+RoutingProtocol::GetLinkRate(Ipv4Address iface) const
+{
+    Ptr<NetDevice> dev = m_ipv4->GetNetDevice(m_ipv4->GetInterfaceForAddress(iface));
+    Ptr<WifiNetDevice> wifi = dev->GetObject<WifiNetDevice>();
+    if (!wifi)
+    {
+        return 0;
+    }
+    // The RREQ is broadcast, so there is no station whose current data mode could be used. The
+    // default mode of the PHY is the lowest one of the standard, the estimate errs on the safe side
+    return wifi->GetRemoteStationManager()->GetDefaultMode().GetDataRate(
+        wifi->GetPhy()->GetChannelWidth());
+}
+
+bool
+RoutingProtocol::ApplyQos(QosExtension& qos, Ipv4Address iface) const
+{
+    uint64_t rate = GetLinkRate(iface);
+    if (rate == 0)
+    {
+        // Nothing is known about the link, do not hold the RREQ back
+        return true;
+    }
+    if (qos.GetBandwidth().GetBitRate() > rate)
+    {
+        return false;
+    }
+    if (qos.GetDelayBound().IsStrictlyPositive())
+    {
+        // Full size frames, so that the estimate errs on the safe side
+        const uint32_t frameBits = 1500 * 8;
+        Time delay = Seconds(double(GetQueueLoad(iface) + 1) * frameBits / rate);
+        if (delay >= qos.GetDelayBound())
+        {
+            return false;
+        }
+        qos.SetDelayBound(qos.GetDelayBound() - delay);
+    }
+    return true;
+}
+
+void
+RoutingProtocol::RecvBetterRequest(const RreqHeader& rreqHeader,
+                                   Ipv4Address receiver,
+                                   Ipv4Address src,
+                                   uint32_t load)
+{
+    std::map<std::pair<Ipv4Address, uint32_t>, HeldRreq>::iterator i =
+        m_heldRreq.find(std::make_pair(rreqHeader.GetOrigin(), rreqHeader.GetId()));
+    if (i == m_heldRreq.end())
+    {
+        return;
+    }
+    uint8_t hop = rreqHeader.GetHopCount() + 1;
+    uint32_t cost = ReverseRouteCost(hop, src, load);
+    if (cost >= i->second.cost)
+    {
+        return;
+    }
+    NS_LOG_LOGIC("Better copy of RREQ " << rreqHeader.GetId() << " from " << src << ", cost "
+                                        << cost << " instead of " << i->second.cost);
+    i->second.cost = cost;
+    RreqHeader better = rreqHeader;
+    better.SetHopCount(hop);
+    UpdateReverseRoute(better, receiver, src);
+}
+
+bool
+RoutingProtocol::HoldReply(const RreqHeader& rreqHeader, uint8_t prefixSize, Ipv4Address alternate)
+{
+    std::map<std::pair<Ipv4Address, uint32_t>, HeldRreq>::iterator i =
+        m_heldRreq.find(std::make_pair(rreqHeader.GetOrigin(), rreqHeader.GetId()));
+    if (i == m_heldRreq.end())
+    {
+        return false;
+    }
+    if (alternate != Ipv4Address())
+    {
+        // The alternate RREPs leave with the RREP of the best copy, not ahead of it
+        if (std::find(i->second.alternates.begin(), i->second.alternates.end(), alternate) ==
+            i->second.alternates.end())
+        {
+            i->second.alternates.push_back(alternate);
+        }
+        return true;
+    }
+    if (i->second.replyPending)
+    {
+        return false;
+    }
+    // The RREP follows the best reverse route known when the holding window closes
+    i->second.replyPending = true;
+    i->second.request = rreqHeader;
+    i->second.prefixSize = prefixSize;
+    return true;
+}
+
+void
+RoutingProtocol::HeldRequestExpire(Ipv4Address origin, uint32_t id)
+{
+    std::map<std::pair<Ipv4Address, uint32_t>, HeldRreq>::iterator i =
+        m_heldRreq.find(std::make_pair(origin, id));
+    if (i == m_heldRreq.end())
+    {
+        return;
+    }
+    HeldRreq held = i->second;
+    m_heldRreq.erase(i);
+    RoutingTableEntry toOrigin;
+    if (!held.replyPending || !m_routingTable.LookupValidRoute(origin, toOrigin))
+    {
+        return;
+    }
+    NS_LOG_DEBUG("Send held reply to " << origin << " via " << toOrigin.GetNextHop());
+    SendReply(held.request, toOrigin, held.prefixSize);
+    // Then one RREP per alternate path still known, the best copy may have taken over one of them
+    const std::vector<RoutingTableEntry::AlternatePath>& paths = toOrigin.GetAlternatePaths();
+    for (std::vector<Ipv4Address>::const_iterator j = held.alternates.begin();
+         j != held.alternates.end();
+         ++j)
+    {
+        for (std::vector<RoutingTableEntry::AlternatePath>::const_iterator k = paths.begin();
+             k != paths.end();
+             ++k)
+        {
+            if (k->nextHop != *j || *j == toOrigin.GetNextHop() || k->expire < Simulator::Now())
+            {
+                continue;
+            }
+            RoutingTableEntry viaPath(/*dev=*/k->dev,
+                                      /*dst=*/origin,
+                                      /*vSeqNo=*/true,
+                                      /*seqNo=*/toOrigin.GetSeqNo(),
+                                      /*iface=*/k->iface,
+                                      /*hops=*/k->hops,
+                                      /*nextHop=*/k->nextHop,
+                                      /*lifetime=*/k->expire - Simulator::Now());
+            NS_LOG_DEBUG("Send held reply to " << origin << " on alternate path via " << *j);
+            SendReply(held.request, viaPath, held.prefixSize);
+        }
+    }
+}
+
+bool
+RoutingProtocol::AnswerRequest(RreqHeader& rreqHeader, Ipv4Address src)
+{
+    Ipv4Address origin = rreqHeader.GetOrigin();
+    RoutingTableEntry toOrigin;
+    //  A node generates a RREP if either:
+    //  (i)  it is itself the destination,
+    if (IsMyOwnAddress(rreqHeader.GetDst()))
+    {
+        NS_LOG_DEBUG("Send reply since I am the destination");
+        if (!HoldReply(rreqHeader, 0))
+        {
+            m_routingTable.LookupRoute(origin, toOrigin);
+            SendReply(rreqHeader, toOrigin);
+        }
+        return true;
+    }
+    // or it is the border node of a subnet holding the destination
+    uint8_t prefixSize = GetHostedPrefixSize(rreqHeader.GetDst());
+    if (prefixSize != 0)
+    {
+        NS_LOG_DEBUG("Send reply since I host the subnet of the destination");
+        if (!HoldReply(rreqHeader, prefixSize))
+        {
+            m_routingTable.LookupRoute(origin, toOrigin);
+            SendReply(rreqHeader, toOrigin, prefixSize);
+        }
+        return true;
+    }
+    /*
+     * (ii) or it has an active route to the destination, the destination sequence number in the
+     * node's existing route table entry for the destination is valid and greater than or equal to
+     * the Destination Sequence Number of the RREQ, and the "destination only" flag is NOT set.
+     */
+    RoutingTableEntry toDst;
+    Ipv4Address dst = rreqHeader.GetDst();
+    if (m_routingTable.LookupRoute(dst, toDst))
+    {
+        /*
+         * Drop RREQ, This node RREP will make a loop.
+         */
+        if (toDst.GetNextHop() == src)
+        {
+            NS_LOG_DEBUG("Drop RREQ from " << src << ", dest next hop " << toDst.GetNextHop());
+            return true;
+        }
+        /*
+         * The Destination Sequence number for the requested destination is set to the maximum of
+         * the corresponding value received in the RREQ message, and the destination sequence value
+         * currently maintained by the node for the requested destination. However, the forwarding
+         * node MUST NOT modify its maintained value for the destination sequence number, even if
+         * the value received in the incoming RREQ is larger than the value currently maintained by
+         * the forwarding node.
+         */
         if ((rreqHeader.GetUnknownSeqno() ||
              (int32_t(toDst.GetSeqNo()) - int32_t(rreqHeader.GetDstSeqno()) >= 0)) &&
             toDst.GetValidSeqNo())
@@ -1489,57 +3087,463 @@ RoutingProtocol::RecvRequest(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address sr
             if (!rreqHeader.GetDestinationOnly() && toDst.GetFlag() == VALID)
             {
                 m_routingTable.LookupRoute(origin, toOrigin);
-                SendReplyByIntermediateNode(toDst, toOrigin, rreqHeader.GetGratuitousRrep());
-                return;
+                SendReplyByIntermediateNode(toDst,
+                                            toOrigin,
+                                            rreqHeader.GetGratuitousRrep(),
+                                            dst);
+                return true;
             }
             rreqHeader.SetDstSeqno(toDst.GetSeqNo());
             rreqHeader.SetUnknownSeqno(false);
         }
     }
+    else if (m_routingTable.LookupLongestPrefixRoute(dst, toDst))
+    {
+        /*
+         * A subnet route answers for every node of the subnet. Its sequence number is the one of
+         * the border node, which says nothing about the sequence number of the destination.
+         */
+        if (toDst.GetNextHop() == src)
+        {
+            NS_LOG_DEBUG("Drop RREQ from " << src << ", subnet next hop " << toDst.GetNextHop());
+            return true;
+        }
+        if (!rreqHeader.GetDestinationOnly())
+        {
+            // The destination is not known to the border node, a gratuitous RREP would not reach it
+            m_routingTable.LookupRoute(origin, toOrigin);
+            SendReplyByIntermediateNode(toDst, toOrigin, /*gratRep=*/false, dst);
+            return true;
+        }
+    }
+    return false;
+}
 
-    SocketIpTtlTag tag;
-    p->RemovePacketTag(tag);
-    if (tag.GetTtl() < 2)
+uint8_t
+RoutingProtocol::GetHostedPrefixSize(Ipv4Address dst) const
+{
+    uint8_t prefixSize = 0;
+    for (std::vector<std::pair<Ipv4Address, Ipv4Mask>>::const_iterator i =
+             m_hostedPrefixes.begin();
+         i != m_hostedPrefixes.end();
+         ++i)
+    {
+        if (i->second.IsMatch(dst, i->first))
+        {
+            prefixSize = std::max(prefixSize, uint8_t(i->second.GetPrefixLength()));
+        }
+    }
+    return prefixSize;
+}
+
+bool
+RoutingProtocol::ExtendPath(PathExtension& path, Ipv4Address node) const
+{
+    if (path.GetPath().size() >= m_maxPathLength || !path.AddNode(node))
+    {
+        // A path missing a forwarder would give wrong hop counts downstream, drop it
+        NS_LOG_LOGIC("Path too long, dropped");
+        return false;
+    }
+    return true;
+}
+
+void
+RoutingProtocol::LearnPath(const PathExtension& path, Ipv4Address sender, Ipv4Address receiver)
+{
+    NS_LOG_FUNCTION(this << path << sender);
+    const std::vector<Ipv4Address>& nodes = path.GetPath();
+    if (nodes.empty() || nodes.back() != sender)
+    {
+        return;
+    }
+    int32_t interface = m_ipv4->GetInterfaceForAddress(receiver);
+    Ptr<NetDevice> dev = m_ipv4->GetNetDevice(interface);
+    Ipv4InterfaceAddress iface = m_ipv4->GetAddress(interface, 0);
+    for (std::size_t i = 0; i < nodes.size(); ++i)
+    {
+        if (IsMyOwnAddress(nodes[i]))
+        {
+            continue;
+        }
+        uint16_t hops = nodes.size() - i;
+        /*
+         * The path gives no destination sequence number, so it never replaces a valid route nor
+         * disturbs a route discovery. The sequence number of an invalid route is kept.
+         */
+        RoutingTableEntry rt;
+        bool exists = m_routingTable.LookupRoute(nodes[i], rt);
+        if (exists && (rt.GetFlag() == VALID || rt.GetFlag() == IN_SEARCH))
+        {
+            continue;
+        }
+        RoutingTableEntry newEntry(/*dev=*/dev,
+                                   /*dst=*/nodes[i],
+                                   /*vSeqNo=*/false,
+                                   /*seqNo=*/rt.GetSeqNo(),
+                                   /*iface=*/iface,
+                                   /*hops=*/hops,
+                                   /*nextHop=*/sender,
+                                   /*lifetime=*/GetActiveRouteTimeout(sender));
+        NS_LOG_LOGIC("Learn route to " << nodes[i] << " via " << sender << ", " << hops << " hops");
+        if (exists)
+        {
+            m_routingTable.Update(newEntry);
+        }
+        else
+        {
+            m_routingTable.AddRoute(newEntry);
+        }
+    }
+}
+
+Ptr<Ipv4Route>
+RoutingProtocol::SelectRoute(const RoutingTableEntry& rt,
+                             Ptr<const Packet> p,
+                             const Ipv4Header& header,
+                             bool local) const
+{
+    if (!m_enableStriping || rt.GetAlternatePaths().empty())
+    {
+        return rt.GetRoute();
+    }
+    if (!local)
+    {
+        return rt.GetRoute(FlowHash(p, header, header.GetSource(), true));
+    }
+    // The source address of a local packet may not be chosen yet, take the one of the route.
+    // UDP adds its header after the route is found, only TCP hands over the segment with ports.
+    return rt.GetRoute(FlowHash(p,
+                                header,
+                                rt.GetInterface().GetLocal(),
+                                header.GetProtocol() == TcpL4Protocol::PROT_NUMBER));
+}
+
+uint32_t
+RoutingProtocol::FlowHash(Ptr<const Packet> p,
+                          const Ipv4Header& header,
+                          Ipv4Address source,
+                          bool ports) const
+{
+    uint8_t buffer[13];
+    source.Serialize(buffer);
+    header.GetDestination().Serialize(buffer + 4);
+    buffer[8] = header.GetProtocol();
+    uint32_t size = 9;
+    // Fragments after the first one carry no ports, leave them out for all fragments
+    if (ports &&
+        (header.GetProtocol() == UdpL4Protocol::PROT_NUMBER ||
+         header.GetProtocol() == TcpL4Protocol::PROT_NUMBER) &&
+        header.IsLastFragment() && header.GetFragmentOffset() == 0 && p->GetSize() >= 4)
+    {
+        // Source and destination ports are the first four bytes of both UDP and TCP headers
+        p->CopyData(buffer + 9, 4);
+        size = 13;
+    }
+    return Hash32(reinterpret_cast<const char*>(buffer), size);
+}
+
+void
+RoutingProtocol::RecvAlternateRequest(const RreqHeader& rreqHeader,
+                                      Ipv4Address receiver,
+                                      Ipv4Address src)
+{
+    NS_LOG_FUNCTION(this << rreqHeader.GetOrigin() << src);
+    Ipv4Address origin = rreqHeader.GetOrigin();
+    RoutingTableEntry toOrigin;
+    if (IsMyOwnAddress(origin) || !m_routingTable.LookupValidRoute(origin, toOrigin) ||
+        toOrigin.GetSeqNo() != rreqHeader.GetOriginSeqno())
+    {
+        return;
+    }
+    int32_t interface = m_ipv4->GetInterfaceForAddress(receiver);
+    Ptr<NetDevice> dev = m_ipv4->GetNetDevice(interface);
+    Ipv4InterfaceAddress iface = m_ipv4->GetAddress(interface, 0);
+    uint8_t hop = rreqHeader.GetHopCount() + 1;
+    Time lifetime = Time(2 * m_netTraversalTime - 2 * hop * m_nodeTraversalTime);
+    if (!toOrigin.InsertAlternatePath(src, dev, iface, hop, lifetime, m_maxPaths))
+    {
+        return;
+    }
+    NS_LOG_LOGIC("Alternate path to " << origin << " via " << src);
+    m_routingTable.Update(toOrigin);
+
+    if (IsMyOwnAddress(rreqHeader.GetDst()))
+    {
+        RoutingTableEntry viaSrc(/*dev=*/dev,
+                                 /*dst=*/origin,
+                                 /*vSeqNo=*/true,
+                                 /*seqNo=*/rreqHeader.GetOriginSeqno(),
+                                 /*iface=*/iface,
+                                 /*hops=*/hop,
+                                 /*nextHop=*/src,
+                                 /*lifetime=*/lifetime);
+        NS_LOG_DEBUG("Send reply on alternate path since I am the destination");
+        if (!HoldReply(rreqHeader, 0, src))
+        {
+            SendReply(rreqHeader, viaSrc);
+        }
+    }
+}
+
+void
+RoutingProtocol::ForwardRequest(const RreqHeader& rreqHeader,
+                                uint8_t ttl,
+                                Ipv4Address src,
+                                Ptr<const Packet> extensions)
+{
+    NS_LOG_FUNCTION(this << rreqHeader.GetOrigin() << rreqHeader.GetId() << src);
+    // The forwarded RREQ is identical on every interface, serialize it once
+    Ptr<Packet> rreq = CreateControlPacket(rreqHeader, MADAODVTYPE_RREQ, ttl, extensions);
+    switch (m_rreqSuppression)
+    {
+    case RREQ_SUPPRESSION_GOSSIP:
+        if (rreqHeader.GetHopCount() > m_rreqGossipHops &&
+            m_uniformRandomVariable->GetValue(0, 1) >= m_rreqGossipProbability)
+        {
+            NS_LOG_DEBUG("Gossip: do not rebroadcast RREQ " << rreqHeader.GetId() << " from "
+                                                            << rreqHeader.GetOrigin());
+            return;
+        }
+        BroadcastRequest(rreq, true, src);
+        break;
+    case RREQ_SUPPRESSION_COUNTER:
+    case RREQ_SUPPRESSION_COVERAGE: {
+        // Wait for the jitter as a whole, so that the duplicates overheard meanwhile can cancel
+        // the rebroadcast on every interface
+        PendingRreq& pending =
+            m_pendingRreq[std::make_pair(rreqHeader.GetOrigin(), rreqHeader.GetId())];
+        pending.packet = rreq;
+        pending.copies = 0;
+        pending.heard.assign(1, src);
+        pending.event = Simulator::Schedule(GetBroadcastJitter(src),
+                                            &RoutingProtocol::PendingRequestExpire,
+                                            this,
+                                            rreqHeader.GetOrigin(),
+                                            rreqHeader.GetId());
+        break;
+    }
+    default:
+        BroadcastRequest(rreq, true, src);
+        break;
+    }
+}
+
+void
+RoutingProtocol::RecvDuplicateRequest(Ipv4Address origin, uint32_t id, Ipv4Address src)
+{
+    std::map<std::pair<Ipv4Address, uint32_t>, PendingRreq>::iterator i =
+        m_pendingRreq.find(std::make_pair(origin, id));
+    if (i == m_pendingRreq.end())
+    {
+        return;
+    }
+    i->second.copies++;
+    if (std::find(i->second.heard.begin(), i->second.heard.end(), src) == i->second.heard.end())
+    {
+        i->second.heard.push_back(src);
+    }
+}
+
+void
+RoutingProtocol::PendingRequestExpire(Ipv4Address origin, uint32_t id)
+{
+    std::map<std::pair<Ipv4Address, uint32_t>, PendingRreq>::iterator i =
+        m_pendingRreq.find(std::make_pair(origin, id));
+    if (i == m_pendingRreq.end())
+    {
+        return;
+    }
+    PendingRreq pending = i->second;
+    m_pendingRreq.erase(i);
+
+    if (m_rreqSuppression == RREQ_SUPPRESSION_COUNTER &&
+        pending.copies >= m_rreqSuppressionCounter)
+    {
+        NS_LOG_DEBUG("Counter: " << pending.copies << " copies of RREQ " << id << " from "
+                                 << origin << " overheard, cancel rebroadcast");
+        return;
+    }
+    if (m_rreqSuppression == RREQ_SUPPRESSION_COVERAGE)
+    {
+        std::vector<Ipv4Address> neighbors;
+        m_nb.GetNeighbors(neighbors);
+        bool covered = !neighbors.empty();
+        for (std::vector<Ipv4Address>::const_iterator j = neighbors.begin();
+             covered && j != neighbors.end();
+             ++j)
+        {
+            covered = std::find(pending.heard.begin(), pending.heard.end(), *j) !=
+                      pending.heard.end();
+        }
+        if (covered)
+        {
+            NS_LOG_DEBUG("Coverage: all neighbors sent RREQ " << id << " from " << origin
+                                                              << ", cancel rebroadcast");
+            return;
+        }
+    }
+    BroadcastRequest(pending.packet, false);
+}
+
+void
+RoutingProtocol::BroadcastRequest(Ptr<Packet> rreq, bool jitter, Ipv4Address src)
+{
+    for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin();
+         j != m_socketAddresses.end();
+         ++j)
+    {
+        Ptr<Socket> socket = j->first;
+        Ipv4InterfaceAddress iface = j->second;
+        Ptr<Packet> packet = rreq->Copy();
+        // Send to all-hosts broadcast if on /32 addr, subnet-directed otherwise
+        Ipv4Address destination;
+        if (iface.GetMask() == Ipv4Mask::GetOnes())
+        {
+            destination = Ipv4Address("255.255.255.255");
+        }
+        else
+        {
+            destination = iface.GetBroadcast();
+        }
+        m_lastBcastTime = Simulator::Now();
+        if (jitter)
+        {
+            Simulator::Schedule(GetBroadcastJitter(src),
+                                &RoutingProtocol::SendTo,
+                                this,
+                                socket,
+                                packet,
+                                destination);
+        }
+        else
+        {
+            SendTo(socket, packet, destination);
+        }
+    }
+}
+
+Time
+RoutingProtocol::GetBroadcastJitter(Ipv4Address src)
+{
+    Time window = MilliSeconds(10);
+    if (m_jitterPerNeighbor.IsStrictlyPositive())
+    {
+        // Count this node too, so that an isolated node still jitters its broadcasts
+        window = std::min(m_maxJitter,
+                          Time(m_jitterPerNeighbor.GetDouble() * (m_nb.GetNeighborCount() + 1)));
+    }
+    double rssi;
+    if (m_enableJitterRssiBias && src != Ipv4Address() && m_nb.GetRssi(src, rssi))
+    {
+        // 0 at the edge of the radio range, where links are predicted to fail, 1 from 30 dB above
+        double closeness = std::min(1.0, std::max(0.0, (rssi - m_preemptiveRssiThreshold) / 30));
+        return Time(window.GetDouble() * (closeness + m_uniformRandomVariable->GetValue(0, 1)) / 2);
+    }
+    if (!m_jitterPerNeighbor.IsStrictlyPositive())
+    {
+        return Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10)));
+    }
+    return Time(m_uniformRandomVariable->GetValue(0, window.GetDouble()));
+}
+
+Time
+RoutingProtocol::GetActiveRouteTimeout(Ipv4Address nextHop)
+{
+    if (!m_enableAdaptiveRouteTimeout)
+    {
+        return m_activeRouteTimeout;
+    }
+    Time estimate = m_nb.GetLinkLifetime(nextHop);
+    if (estimate.IsZero())
+    {
+        return m_activeRouteTimeout;
+    }
+    return std::min(std::max(estimate, m_minActiveRouteTimeout), m_maxActiveRouteTimeout);
+}
+
+Time
+RoutingProtocol::GetMyRouteTimeout(Ipv4Address nextHop)
+{
+    if (!m_enableAdaptiveRouteTimeout)
+    {
+        return m_myRouteTimeout;
+    }
+    /*
+     * MyRouteTimeout is 2 * max(ActiveRouteTimeout, PathDiscoveryTime); keep that ratio but scale
+     * the active part by what the first link of the reverse path is expected to last.
+     */
+    return Time(2 * std::max(GetActiveRouteTimeout(nextHop), m_pathDiscoveryTime));
+}
+
+bool
+RoutingProtocol::RequestRoute(Ipv4Address dst)
+{
+    NS_LOG_FUNCTION(this << dst);
+    if (m_socketAddresses.empty())
+    {
+        NS_LOG_LOGIC("No madaodv interfaces");
+        return false;
+    }
+    RoutingTableEntry rt;
+    if (m_routingTable.LookupLongestPrefixRoute(dst, rt))
+    {
+        return true;
+    }
+    bool result = m_routingTable.LookupRoute(dst, rt);
+    if (!result || rt.GetFlag() != IN_SEARCH)
+    {
+        NS_LOG_LOGIC("Send new RREQ for requested route to " << dst);
+        SendRequest(dst);
+    }
+    return false;
+}
+
+void
+RoutingProtocol::AddHostedPrefix(Ipv4Address network, Ipv4Mask mask)
+{
+    NS_LOG_FUNCTION(this << network << mask);
+    NS_ASSERT_MSG(mask.GetPrefixLength() > 0 && mask.GetPrefixLength() < 32,
+                  "A hosted subnet needs a prefix length in [1, 31]");
+    m_hostedPrefixes.push_back(std::make_pair(network.CombineMask(mask), mask));
+}
+
+void
+RoutingProtocol::SetQosRequirement(Ipv4Address dst, Time maxDelay, DataRate minBandwidth)
+{
+    NS_LOG_FUNCTION(this << dst << maxDelay << minBandwidth);
+    if (!maxDelay.IsStrictlyPositive() && minBandwidth.GetBitRate() == 0)
     {
-        NS_LOG_DEBUG("TTL exceeded. Drop RREQ origin " << src << " destination " << dst);
+        m_qosRequirements.erase(dst);
         return;
     }
+    m_qosRequirements[dst] = QosExtension(maxDelay, minBandwidth);
+}
 
-    for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin();
-         j != m_socketAddresses.end();
-         ++j)
-    {
-        Ptr<Socket> socket = j->first;
-        Ipv4InterfaceAddress iface = j->second;
-        Ptr<Packet> packet = Create<Packet>();
-        SocketIpTtlTag ttl;
-        ttl.SetTtl(tag.GetTtl() - 1);
-        packet->AddPacketTag(ttl);
-        packet->AddHeader(rreqHeader);
-        TypeHeader tHeader(MADAODVTYPE_RREQ);
-        packet->AddHeader(tHeader);
-        // Send to all-hosts broadcast if on /32 addr, subnet-directed otherwise
-        Ipv4Address destination;
-        if (iface.GetMask() == Ipv4Mask::GetOnes())
-        {
-            destination = Ipv4Address("255.255.255.255");
-        }
-        else
-        {
-            destination = iface.GetBroadcast();
-        }
-        m_lastBcastTime = Simulator::Now();
-        Simulator::Schedule(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))),
-                            &RoutingProtocol::SendTo,
-                            this,
-                            socket,
-                            packet,
-                            destination);
-    }
+void
+RoutingProtocol::RouteStateChanged(Ipv4Address dst, bool valid)
+{
+    // Report once the routing table operation is over, the trace sinks may use the table again
+    Simulator::ScheduleNow(&RoutingProtocol::NotifyRouteState, this, dst, valid);
+}
+
+void
+RoutingProtocol::NotifyRouteState(Ipv4Address dst, bool valid)
+{
+    NS_LOG_FUNCTION(this << dst << valid);
+    m_routeStateTrace(dst, valid);
+}
+
+void
+RoutingProtocol::SetLinkLifetimeWeight(double weight)
+{
+    m_nb.SetLinkLifetimeWeight(weight);
 }
 
 void
-RoutingProtocol::SendReply(const RreqHeader& rreqHeader, const RoutingTableEntry& toOrigin)
+RoutingProtocol::SendReply(const RreqHeader& rreqHeader,
+                           const RoutingTableEntry& toOrigin,
+                           uint8_t prefixSize)
 {
     NS_LOG_FUNCTION(this << toOrigin.GetDestination());
     /*
@@ -1551,16 +3555,21 @@ RoutingProtocol::SendReply(const RreqHeader& rreqHeader, const RoutingTableEntry
     {
         m_seqNo++;
     }
-    RrepHeader rrepHeader(/*prefixSize=*/0,
+    RrepHeader rrepHeader(/*prefixSize=*/prefixSize,
                           /*hopCount=*/0,
                           /*dst=*/rreqHeader.GetDst(),
                           /*dstSeqNo=*/m_seqNo,
                           /*origin=*/toOrigin.GetDestination(),
-                          /*lifetime=*/m_myRouteTimeout);
+                          /*lifetime=*/GetMyRouteTimeout(toOrigin.GetNextHop()));
     Ptr<Packet> packet = Create<Packet>();
     SocketIpTtlTag tag;
     tag.SetTtl(toOrigin.GetHop());
     packet->AddPacketTag(tag);
+    if (m_enablePathAccumulation)
+    {
+        // The path starts empty, the destination is in the fixed part
+        packet->AddHeader(PathExtension());
+    }
     packet->AddHeader(rrepHeader);
     TypeHeader tHeader(MADAODVTYPE_RREP);
     packet->AddHeader(tHeader);
@@ -1572,19 +3581,22 @@ RoutingProtocol::SendReply(const RreqHeader& rreqHeader, const RoutingTableEntry
 void
 RoutingProtocol::SendReplyByIntermediateNode(RoutingTableEntry& toDst,
                                              RoutingTableEntry& toOrigin,
-                                             bool gratRep)
+                                             bool gratRep,
+                                             Ipv4Address dst)
 {
     NS_LOG_FUNCTION(this);
-    RrepHeader rrepHeader(/*prefixSize=*/0,
+    // Like the border node, answer for a subnet with the requested address and the prefix size
+    RrepHeader rrepHeader(/*prefixSize=*/toDst.GetPrefixSize(),
                           /*hopCount=*/toDst.GetHop(),
-                          /*dst=*/toDst.GetDestination(),
+                          /*dst=*/dst,
                           /*dstSeqNo=*/toDst.GetSeqNo(),
                           /*origin=*/toOrigin.GetDestination(),
                           /*lifetime=*/toDst.GetLifeTime());
     /* If the node we received a RREQ for is a neighbor we are
-     * probably facing a unidirectional link... Better request a RREP-ack
+     * probably facing a unidirectional link... Better request a RREP-ack, unless the hellos of
+     * the next hop told that it hears us
      */
-    if (toDst.GetHop() == 1)
+    if (toDst.GetHop() == 1 && !m_nb.IsSymmetric(toOrigin.GetNextHop()))
     {
         rrepHeader.SetAckRequired(true);
         RoutingTableEntry toNextHop;
@@ -1602,6 +3614,13 @@ RoutingProtocol::SendReplyByIntermediateNode(RoutingTableEntry& toDst,
     SocketIpTtlTag tag;
     tag.SetTtl(toOrigin.GetHop());
     packet->AddPacketTag(tag);
+    if (m_enablePathAccumulation)
+    {
+        // The nodes between this one and the destination are unknown, the path starts here
+        PathExtension path;
+        path.AddNode(toOrigin.GetInterface().GetLocal());
+        packet->AddHeader(path);
+    }
     packet->AddHeader(rrepHeader);
     TypeHeader tHeader(MADAODVTYPE_RREP);
     packet->AddHeader(tHeader);
@@ -1663,10 +3682,19 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
     uint8_t hop = rrepHeader.GetHopCount() + 1;
     rrepHeader.SetHopCount(hop);
 
+    // A route advertisement is flooded to every node
+    if (rrepHeader.GetOrigin() == Ipv4Address::GetBroadcast())
+    {
+        RecvAdvertisement(p, rrepHeader, receiver, sender);
+        return;
+    }
+
     // If RREP is Hello message
     if (dst == rrepHeader.GetOrigin())
     {
+        bool known = m_nb.IsNeighbor(sender);
         ProcessHello(rrepHeader, receiver);
+        ProcessHelloExtensions(p, sender, receiver, known);
         return;
     }
 
@@ -1693,8 +3721,40 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
         /*hops=*/hop,
         /*nextHop=*/sender,
         /*lifetime=*/rrepHeader.GetLifeTime());
+    // A RREP with a prefix size is a route to the whole subnet of the requested destination
+    Ipv4Address requested = dst;
+    if (rrepHeader.GetPrefixSize() > 0 && rrepHeader.GetPrefixSize() < 32)
+    {
+        newEntry.SetPrefixSize(rrepHeader.GetPrefixSize());
+        dst = newEntry.GetDestination();
+        NS_LOG_LOGIC("Route to " << requested << " is a route to subnet " << dst << "/"
+                                 << (uint16_t)rrepHeader.GetPrefixSize());
+    }
+    // Acknowledge receipt of the RREP by sending a RREP-ACK message back, also when the RREP is
+    // dropped below, as the link it came over works in both directions
+    if (rrepHeader.GetAckRequired())
+    {
+        if (m_enablePiggyback)
+        {
+            DeferReplyAck(sender);
+        }
+        else
+        {
+            SendReplyAck(sender);
+        }
+        rrepHeader.SetAckRequired(false);
+    }
     RoutingTableEntry toDst;
-    if (m_routingTable.LookupRoute(dst, toDst))
+    bool exists = m_routingTable.LookupRoute(dst, toDst);
+    if (exists && toDst.GetFlag() == VALID && toDst.GetPrefixSize() != newEntry.GetPrefixSize())
+    {
+        // The entries are keyed by address, a valid route of another prefix size holds the key
+        NS_LOG_DEBUG("Drop RREP for " << dst << "/" << (uint16_t)newEntry.GetPrefixSize()
+                                      << ", the route to " << dst << "/"
+                                      << (uint16_t)toDst.GetPrefixSize() << " is valid");
+        return;
+    }
+    if (exists)
     {
         /*
          * The existing entry is updated only in the following circumstances:
@@ -1723,6 +3783,18 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
             {
                 m_routingTable.Update(newEntry);
             }
+            // Keep an equal sequence number RREP from another neighbor as an alternate path
+            else if (m_enableMultipath && rrepHeader.GetDstSeqno() == toDst.GetSeqNo() &&
+                     toDst.InsertAlternatePath(sender,
+                                               dev,
+                                               newEntry.GetInterface(),
+                                               hop,
+                                               rrepHeader.GetLifeTime(),
+                                               m_maxPaths))
+            {
+                NS_LOG_LOGIC("Alternate path to " << dst << " via " << sender);
+                m_routingTable.Update(toDst);
+            }
         }
     }
     else
@@ -1731,11 +3803,17 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
         NS_LOG_LOGIC("add new route");
         m_routingTable.AddRoute(newEntry);
     }
-    // Acknowledge receipt of the RREP by sending a RREP-ACK message back
-    if (rrepHeader.GetAckRequired())
+    RoutingTableEntry toSubnet;
+    if (newEntry.GetPrefixSize() != 0 && m_routingTable.LookupValidRoute(dst, toSubnet) &&
+        toSubnet.GetPrefixSize() == newEntry.GetPrefixSize())
     {
-        SendReplyAck(sender);
-        rrepHeader.SetAckRequired(false);
+        SubnetRouteFound(toSubnet);
+    }
+    PathExtension path;
+    bool hasPath = m_enablePathAccumulation && PeekExtension(p, MADAODVEXT_PATH, path);
+    if (hasPath)
+    {
+        LearnPath(path, sender, receiver);
     }
     NS_LOG_LOGIC("receiver " << receiver << " origin " << rrepHeader.GetOrigin());
     if (IsMyOwnAddress(rrepHeader.GetOrigin()))
@@ -1746,8 +3824,9 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
             m_addressReqTimer[dst].Cancel();
             m_addressReqTimer.erase(dst);
         }
+        LocalRepairDone(dst);
         m_routingTable.LookupRoute(dst, toDst);
-        SendPacketFromQueue(dst, toDst.GetRoute());
+        SendPacketFromQueue(dst, toDst.GetRoute(), toDst.GetPrefixMask());
         return;
     }
 
@@ -1761,7 +3840,7 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
     m_routingTable.Update(toOrigin);
 
     // Update information about precursors
-    if (m_routingTable.LookupValidRoute(rrepHeader.GetDst(), toDst))
+    if (m_routingTable.LookupValidRoute(dst, toDst))
     {
         toDst.InsertPrecursor(toOrigin.GetNextHop());
         m_routingTable.Update(toDst);
@@ -1792,6 +3871,10 @@ RoutingProtocol::RecvReply(Ptr<Packet> p, Ipv4Address receiver, Ipv4Address send
     SocketIpTtlTag ttl;
     ttl.SetTtl(tag.GetTtl() - 1);
     packet->AddPacketTag(ttl);
+    if (hasPath && ExtendPath(path, receiver))
+    {
+        packet->AddHeader(path);
+    }
     packet->AddHeader(rrepHeader);
     TypeHeader tHeader(MADAODVTYPE_RREP);
     packet->AddHeader(tHeader);
@@ -1813,6 +3896,162 @@ RoutingProtocol::RecvReplyAck(Ipv4Address neighbor)
     }
 }
 
+void
+RoutingProtocol::AttachPiggyback(Ptr<const Packet> p, Ptr<Ipv4Route> route)
+{
+    PiggybackTag tag;
+    if (!m_enablePiggyback || !p || p->PeekPacketTag(tag))
+    {
+        return;
+    }
+    Ipv4Address nextHop = route->GetGateway();
+    // The pending RREP_ACK is settled in NotifyPiggybackTx, once the packet leaves for the
+    // device. Until then it may still be dropped and the RREP_ACK must go out on its own.
+    bool ack = m_pendingAck.find(nextHop) != m_pendingAck.end();
+    p->AddPacketTag(PiggybackTag(route->GetSource(), nextHop, m_seqNo, ack));
+}
+
+void
+RoutingProtocol::NotifyPiggybackTx(Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+    PiggybackTag tag;
+    if (!packet->PeekPacketTag(tag) || !IsMyOwnAddress(tag.GetSender()))
+    {
+        return;
+    }
+    Ipv4Address nextHop = tag.GetNextHop();
+    if (tag.GetAck())
+    {
+        std::map<Ipv4Address, EventId>::iterator ack = m_pendingAck.find(nextHop);
+        if (ack != m_pendingAck.end())
+        {
+            NS_LOG_LOGIC("Piggyback RREP_ACK to " << nextHop);
+            ack->second.Cancel();
+            m_pendingAck.erase(ack);
+        }
+    }
+    m_piggybackTime[nextHop] = Simulator::Now();
+}
+
+Ptr<const Packet>
+RoutingProtocol::ProcessPiggyback(Ptr<const Packet> p, int32_t iif)
+{
+    PiggybackTag tag;
+    if (!p->PeekPacketTag(tag))
+    {
+        return p;
+    }
+    // A forwarded packet must carry the tag of this node only, and a delivered one no tag
+    Ptr<Packet> copy = p->Copy();
+    copy->RemovePacketTag(tag);
+    if (IsMyOwnAddress(tag.GetSender()))
+    {
+        return copy;
+    }
+    NS_LOG_LOGIC("Piggybacked refresh from " << tag.GetSender());
+    // The refresh is handled like a HELLO of the transmitting node
+    RrepHeader refresh(/*prefixSize=*/0,
+                       /*hopCount=*/0,
+                       /*dst=*/tag.GetSender(),
+                       /*dstSeqNo=*/tag.GetSeqNo(),
+                       /*origin=*/tag.GetSender(),
+                       /*lifetime=*/Time(m_allowedHelloLoss * m_helloInterval));
+    ProcessHello(refresh, m_ipv4->GetAddress(iif, 0).GetLocal());
+    if (tag.GetAck())
+    {
+        RecvReplyAck(tag.GetSender());
+    }
+    return copy;
+}
+
+void
+RoutingProtocol::DeferReplyAck(Ipv4Address neighbor)
+{
+    NS_LOG_FUNCTION(this << neighbor);
+    std::map<Ipv4Address, EventId>::iterator ack = m_pendingAck.find(neighbor);
+    if (ack != m_pendingAck.end())
+    {
+        ack->second.Cancel();
+    }
+    // Leave half of NextHopWait to the RREP_ACK message if no packet goes to the neighbor
+    m_pendingAck[neighbor] = Simulator::Schedule(m_nextHopWait / 2,
+                                                 &RoutingProtocol::SendPendingReplyAck,
+                                                 this,
+                                                 neighbor);
+}
+
+void
+RoutingProtocol::SendPendingReplyAck(Ipv4Address neighbor)
+{
+    m_pendingAck.erase(neighbor);
+    SendReplyAck(neighbor);
+}
+
+bool
+RoutingProtocol::NeighborsCoveredByPiggyback()
+{
+    std::vector<Ipv4Address> neighbors;
+    m_nb.GetNeighbors(neighbors);
+    if (neighbors.empty())
+    {
+        return false;
+    }
+    for (std::vector<Ipv4Address>::const_iterator i = neighbors.begin(); i != neighbors.end(); ++i)
+    {
+        std::map<Ipv4Address, Time>::const_iterator sent = m_piggybackTime.find(*i);
+        if (sent == m_piggybackTime.end() || Simulator::Now() - sent->second >= m_helloInterval)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+RoutingProtocol::PeekExtension(Ptr<const Packet> p, uint8_t type, Header& extension) const
+{
+    Ptr<Packet> rest = p->Copy();
+    ExtensionHeader header;
+    while (rest->GetSize() >= header.GetSerializedSize())
+    {
+        rest->PeekHeader(header);
+        uint32_t size = header.GetSerializedSize() + header.GetLength();
+        if (rest->GetSize() < size)
+        {
+            NS_LOG_DEBUG("Truncated extension of type " << (uint16_t)header.GetType());
+            return false;
+        }
+        if (header.GetType() == type)
+        {
+            rest->PeekHeader(extension);
+            return true;
+        }
+        // Skip the other extensions, known or not
+        rest->RemoveAtStart(size);
+    }
+    return false;
+}
+
+void
+RoutingProtocol::ProcessHelloExtensions(Ptr<const Packet> p,
+                                        Ipv4Address sender,
+                                        Ipv4Address receiver,
+                                        bool known)
+{
+    NeighborSetExtension neighborSet;
+    if (PeekExtension(p, MADAODVEXT_NEIGHBOR_SET, neighborSet))
+    {
+        bool symmetric = neighborSet.MayContain(receiver);
+        // The first hello of a new neighbor may have been sent before it heard this node
+        if (symmetric || known)
+        {
+            NS_LOG_LOGIC("Link to " << sender << (symmetric ? " is" : " is not")
+                                    << " bidirectional");
+            m_nb.SetSymmetric(sender, symmetric);
+        }
+    }
+}
+
 void
 RoutingProtocol::ProcessHello(const RrepHeader& rrepHeader, Ipv4Address receiver)
 {
@@ -1839,8 +4078,7 @@ RoutingProtocol::ProcessHello(const RrepHeader& rrepHeader, Ipv4Address receiver
     }
     else
     {
-        toNeighbor.SetLifeTime(
-            std::max(Time(m_allowedHelloLoss * m_helloInterval), toNeighbor.GetLifeTime()));
+        toNeighbor.SetLifeTime(std::max(rrepHeader.GetLifeTime(), toNeighbor.GetLifeTime()));
         toNeighbor.SetSeqNo(rrepHeader.GetDstSeqno());
         toNeighbor.SetValidSeqNo(true);
         toNeighbor.SetFlag(VALID);
@@ -1852,7 +4090,9 @@ RoutingProtocol::ProcessHello(const RrepHeader& rrepHeader, Ipv4Address receiver
     }
     if (m_enableHello)
     {
-        m_nb.Update(rrepHeader.GetDst(), Time(m_allowedHelloLoss * m_helloInterval));
+        // The sender advertises how long it may stay silent, AllowedHelloLoss times its
+        // current hello interval
+        m_nb.Update(rrepHeader.GetDst(), rrepHeader.GetLifeTime());
     }
 }
 
@@ -1865,19 +4105,30 @@ RoutingProtocol::RecvError(Ptr<Packet> p, Ipv4Address src)
     std::map<Ipv4Address, uint32_t> dstWithNextHopSrc;
     std::map<Ipv4Address, uint32_t> unreachable;
     m_routingTable.GetListOfDestinationWithNextHop(src, dstWithNextHopSrc);
-    std::pair<Ipv4Address, uint32_t> un;
-    while (rerrHeader.RemoveUnDestination(un))
+    // Both lists are sorted by address, intersect them in a single pass
+    const std::vector<std::pair<Ipv4Address, uint32_t>>& un = rerrHeader.GetUnDestinations();
+    std::vector<std::pair<Ipv4Address, uint32_t>>::const_iterator j = un.begin();
+    std::map<Ipv4Address, uint32_t>::const_iterator k = dstWithNextHopSrc.begin();
+    while (j != un.end() && k != dstWithNextHopSrc.end())
     {
-        for (std::map<Ipv4Address, uint32_t>::const_iterator i = dstWithNextHopSrc.begin();
-             i != dstWithNextHopSrc.end();
-             ++i)
+        if (j->first < k->first)
         {
-            if (i->first == un.first)
-            {
-                unreachable.insert(un);
-            }
+            ++j;
+        }
+        else if (k->first < j->first)
+        {
+            ++k;
+        }
+        else
+        {
+            unreachable.insert(unreachable.end(), *j);
+            ++j;
+            ++k;
         }
     }
+    bool noDelete = rerrHeader.GetNoDelete();
+    rerrHeader.Clear();
+    rerrHeader.SetNoDelete(noDelete);
 
     std::vector<Ipv4Address> precursors;
     for (std::map<Ipv4Address, uint32_t>::const_iterator i = unreachable.begin();
@@ -1885,14 +4136,7 @@ RoutingProtocol::RecvError(Ptr<Packet> p, Ipv4Address src)
     {
         if (!rerrHeader.AddUnDestination(i->first, i->second))
         {
-            TypeHeader typeHeader(MADAODVTYPE_RERR);
-            Ptr<Packet> packet = Create<Packet>();
-            SocketIpTtlTag tag;
-            tag.SetTtl(1);
-            packet->AddPacketTag(tag);
-            packet->AddHeader(rerrHeader);
-            packet->AddHeader(typeHeader);
-            SendRerrMessage(packet, precursors);
+            SendRerrMessage(CreateControlPacket(rerrHeader, MADAODVTYPE_RERR, 1), precursors);
             rerrHeader.Clear();
         }
         else
@@ -1905,18 +4149,36 @@ RoutingProtocol::RecvError(Ptr<Packet> p, Ipv4Address src)
     }
     if (rerrHeader.GetDestCount() != 0)
     {
-        TypeHeader typeHeader(MADAODVTYPE_RERR);
-        Ptr<Packet> packet = Create<Packet>();
-        SocketIpTtlTag tag;
-        tag.SetTtl(1);
-        packet->AddPacketTag(tag);
-        packet->AddHeader(rerrHeader);
-        packet->AddHeader(typeHeader);
-        SendRerrMessage(packet, precursors);
+        SendRerrMessage(CreateControlPacket(rerrHeader, MADAODVTYPE_RERR, 1), precursors);
     }
     m_routingTable.InvalidateRoutesWithDst(unreachable);
 }
 
+void
+RoutingProtocol::SubnetRouteFound(const RoutingTableEntry& toSubnet)
+{
+    NS_LOG_FUNCTION(this << toSubnet.GetDestination());
+    // The route discoveries for hosts of the subnet are over
+    std::vector<Ipv4Address> searched;
+    m_routingTable.GetInSearchDestinations(toSubnet.GetDestination(),
+                                           toSubnet.GetPrefixMask(),
+                                           searched);
+    for (std::vector<Ipv4Address>::const_iterator i = searched.begin(); i != searched.end(); ++i)
+    {
+        NS_LOG_LOGIC("Route to " << *i << " found in subnet " << toSubnet.GetDestination());
+        m_routingTable.DeleteRoute(*i);
+        std::map<Ipv4Address, Timer>::iterator timer = m_addressReqTimer.find(*i);
+        if (timer != m_addressReqTimer.end())
+        {
+            timer->second.Cancel();
+            m_addressReqTimer.erase(timer);
+        }
+    }
+    SendPacketFromQueue(toSubnet.GetDestination(),
+                        toSubnet.GetRoute(),
+                        toSubnet.GetPrefixMask());
+}
+
 void
 RoutingProtocol::RouteRequestTimerExpire(Ipv4Address dst)
 {
@@ -1928,6 +4190,14 @@ RoutingProtocol::RouteRequestTimerExpire(Ipv4Address dst)
         NS_LOG_LOGIC("route to " << dst << " found");
         return;
     }
+    RoutingTableEntry toSubnet;
+    if (m_routingTable.LookupLongestPrefixRoute(dst, toSubnet))
+    {
+        NS_LOG_LOGIC("route to " << dst << " found in subnet " << toSubnet.GetDestination());
+        m_addressReqTimer.erase(dst);
+        SubnetRouteFound(toSubnet);
+        return;
+    }
     /*
      *  If a route discovery has been attempted RreqRetries times at the maximum TTL without
      *  receiving any RREP, all data packets destined for the corresponding destination SHOULD be
@@ -1943,6 +4213,8 @@ RoutingProtocol::RouteRequestTimerExpire(Ipv4Address dst)
         m_routingTable.DeleteRoute(dst);
         NS_LOG_DEBUG("Route not found. Drop all packets with dst " << dst);
         m_queue.DropPacketWithDst(dst);
+        // Reported like every other route state change, once the current event is over
+        RouteStateChanged(dst, false);
         return;
     }
 
@@ -1964,12 +4236,27 @@ void
 RoutingProtocol::HelloTimerExpire()
 {
     NS_LOG_FUNCTION(this);
+    if (m_enableAdaptiveHello)
+    {
+        // Neighbors rely on the advertised lifetime, which covers the next interval, so the
+        // hello is never skipped in favor of another broadcast
+        m_currentHelloInterval = std::min(2 * m_currentHelloInterval, m_maxHelloInterval);
+        SendHello();
+        m_htimer.Cancel();
+        m_htimer.Schedule(m_currentHelloInterval);
+        m_lastBcastTime = Time(Seconds(0));
+        return;
+    }
     Time offset = Time(Seconds(0));
     if (m_lastBcastTime > Time(Seconds(0)))
     {
         offset = Simulator::Now() - m_lastBcastTime;
         NS_LOG_DEBUG("Hello deferred due to last bcast at:" << m_lastBcastTime);
     }
+    else if (m_enablePiggyback && NeighborsCoveredByPiggyback())
+    {
+        NS_LOG_DEBUG("Hello skipped, every neighbor was refreshed by piggybacked packets");
+    }
     else
     {
         SendHello();
@@ -1980,6 +4267,20 @@ RoutingProtocol::HelloTimerExpire()
     m_lastBcastTime = Time(Seconds(0));
 }
 
+void
+RoutingProtocol::NeighborChange()
+{
+    if (!m_enableHello || !m_enableAdaptiveHello || !m_htimer.IsRunning())
+    {
+        return;
+    }
+    NS_LOG_LOGIC("Neighbor set changed, reset hello interval to " << m_helloInterval.As(Time::S));
+    m_currentHelloInterval = m_helloInterval;
+    // Send the next hello at a random point of the minimum interval
+    m_htimer.Cancel();
+    m_htimer.Schedule(Seconds(m_uniformRandomVariable->GetValue(0, m_helloInterval.GetSeconds())));
+}
+
 void
 RoutingProtocol::RreqRateLimitTimerExpire()
 {
@@ -2003,6 +4304,26 @@ RoutingProtocol::AckTimerExpire(Ipv4Address neighbor, Time blacklistTimeout)
     m_routingTable.MarkLinkAsUnidirectional(neighbor, blacklistTimeout);
 }
 
+/// Offset of the destination sequence number in a serialized hello, after the type and the flags,
+/// prefix size, hop count and destination of the RREP
+static const std::size_t HELLO_SEQNO_OFFSET = 8;
+/// Offset of the lifetime in a serialized hello, after the sequence number and the originator
+static const std::size_t HELLO_LIFETIME_OFFSET = 16;
+
+/**
+ * Write a 32 bit field of a serialized message in network order
+ * \param buffer the first byte of the field
+ * \param value the value of the field
+ */
+static void
+WriteHtonU32(uint8_t* buffer, uint32_t value)
+{
+    buffer[0] = (value >> 24) & 0xff;
+    buffer[1] = (value >> 16) & 0xff;
+    buffer[2] = (value >> 8) & 0xff;
+    buffer[3] = value & 0xff;
+}
+
 void
 RoutingProtocol::SendHello()
 {
@@ -2013,25 +4334,50 @@ RoutingProtocol::SendHello()
      *   Hop Count                      0
      *   Lifetime                       AllowedHelloLoss * HelloInterval
      */
-    for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin();
-         j != m_socketAddresses.end();
+    Time lifetime = Time(m_allowedHelloLoss * m_currentHelloInterval);
+    for (std::vector<InterfaceState>::iterator j = m_interfaces.begin(); j != m_interfaces.end();
          ++j)
     {
-        Ptr<Socket> socket = j->first;
-        Ipv4InterfaceAddress iface = j->second;
-        RrepHeader helloHeader(/*prefixSize=*/0,
-                               /*hopCount=*/0,
-                               /*dst=*/iface.GetLocal(),
-                               /*dstSeqNo=*/m_seqNo,
-                               /*origin=*/iface.GetLocal(),
-                               /*lifetime=*/Time(m_allowedHelloLoss * m_helloInterval));
-        Ptr<Packet> packet = Create<Packet>();
+        if (!j->socket)
+        {
+            continue;
+        }
+        Ptr<Socket> socket = j->socket;
+        const Ipv4InterfaceAddress& iface = j->address;
+        if (j->hello.empty())
+        {
+            RrepHeader helloHeader(/*prefixSize=*/0,
+                                   /*hopCount=*/0,
+                                   /*dst=*/iface.GetLocal(),
+                                   /*dstSeqNo=*/m_seqNo,
+                                   /*origin=*/iface.GetLocal(),
+                                   /*lifetime=*/lifetime);
+            Ptr<Packet> hello = Create<Packet>();
+            hello->AddHeader(helloHeader);
+            hello->AddHeader(TypeHeader(MADAODVTYPE_RREP));
+            j->hello.resize(hello->GetSize());
+            hello->CopyData(j->hello.data(), j->hello.size());
+        }
+        // Only the sequence number and the lifetime change between two hellos, patch them in the
+        // serialized message
+        WriteHtonU32(&j->hello[HELLO_SEQNO_OFFSET], m_seqNo);
+        WriteHtonU32(&j->hello[HELLO_LIFETIME_OFFSET], lifetime.GetMilliSeconds());
+        // Every hello is a new packet: a copy would keep the packet UID and receivers would
+        // drop it as a duplicate broadcast.
+        Ptr<Packet> packet = Create<Packet>(j->hello.data(), j->hello.size());
+        if (m_enableHelloNeighborSet)
+        {
+            std::vector<Ipv4Address> neighbors;
+            m_nb.GetNeighbors(neighbors);
+            NeighborSetExtension neighborSet;
+            neighborSet.SetNeighbors(neighbors);
+            Ptr<Packet> extensions = Create<Packet>();
+            extensions->AddHeader(neighborSet);
+            packet->AddAtEnd(extensions);
+        }
         SocketIpTtlTag tag;
         tag.SetTtl(1);
         packet->AddPacketTag(tag);
-        packet->AddHeader(helloHeader);
-        TypeHeader tHeader(MADAODVTYPE_RREP);
-        packet->AddHeader(tHeader);
         // Send to all-hosts broadcast if on /32 addr, subnet-directed otherwise
         Ipv4Address destination;
         if (iface.GetMask() == Ipv4Mask::GetOnes())
@@ -2042,35 +4388,110 @@ RoutingProtocol::SendHello()
         {
             destination = iface.GetBroadcast();
         }
-        Time jitter = Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10)));
+        Time jitter = GetBroadcastJitter();
         Simulator::Schedule(jitter, &RoutingProtocol::SendTo, this, socket, packet, destination);
     }
 }
 
 void
-RoutingProtocol::SendPacketFromQueue(Ipv4Address dst, Ptr<Ipv4Route> route)
+RoutingProtocol::SendPacketFromQueue(Ipv4Address dst, Ptr<Ipv4Route> route, Ipv4Mask mask)
 {
     NS_LOG_FUNCTION(this);
     QueueEntry queueEntry;
-    while (m_queue.Dequeue(dst, queueEntry))
+    while (m_queue.Dequeue(dst, mask, queueEntry))
     {
+        Ptr<const Packet> p = queueEntry.GetPacket();
         DeferredRouteOutputTag tag;
-        Ptr<Packet> p = ConstCast<Packet>(queueEntry.GetPacket());
-        if (p->RemovePacketTag(tag) && tag.GetInterface() != -1 &&
-            tag.GetInterface() != m_ipv4->GetInterfaceForDevice(route->GetOutputDevice()))
+        if (p->PeekPacketTag(tag))
         {
-            NS_LOG_DEBUG("Output device doesn't match. Dropped.");
-            return;
+            if (tag.GetInterface() != -1 &&
+                tag.GetInterface() != m_ipv4->GetInterfaceForDevice(route->GetOutputDevice()))
+            {
+                NS_LOG_DEBUG("Output device doesn't match. Dropped.");
+                queueEntry.GetErrorCallback()(p,
+                                              queueEntry.GetIpv4Header(),
+                                              Socket::ERROR_NOROUTETOHOST);
+                continue;
+            }
+            // The queued packet is shared with the IP layer, strip the tag from a private copy
+            Ptr<Packet> copy = p->Copy();
+            copy->RemovePacketTag(tag);
+            p = copy;
         }
         UnicastForwardCallback ucb = queueEntry.GetUnicastForwardCallback();
         Ipv4Header header = queueEntry.GetIpv4Header();
-        header.SetSource(route->GetSource());
-        header.SetTtl(header.GetTtl() +
-                      1); // compensate extra TTL decrement by fake loopback routing
+        // Locally originated packets take the source address of the route, packets buffered
+        // during a local repair keep the one of their originator
+        if (m_ipv4->GetInterfaceForAddress(header.GetSource()) >= 0)
+        {
+            header.SetSource(route->GetSource());
+        }
+        AttachPiggyback(p, route);
         ucb(route, p, header);
     }
 }
 
+void
+RoutingProtocol::DirectDeferralSend(Ptr<Packet> packet,
+                                    Ipv4Address source,
+                                    Ipv4Address destination,
+                                    uint8_t protocol,
+                                    Ptr<Ipv4Route> route)
+{
+    NS_LOG_FUNCTION(this << packet << source << destination << (uint16_t)protocol);
+    std::map<uint8_t, std::pair<Ptr<IpL4Protocol>, IpL4Protocol::DownTargetCallback>>::iterator
+        i = m_downTargets.find(protocol);
+    NS_ASSERT(i != m_downTargets.end());
+    DeferredRouteOutputTag tag;
+    if (route && route->GetOutputDevice() == m_lo &&
+        route->GetGateway() == Ipv4Address::GetLoopback() &&
+        destination != Ipv4Address::GetLoopback() && !packet->PeekPacketTag(tag))
+    {
+        NS_LOG_DEBUG("Queue packet " << packet->GetUid() << " to " << destination
+                                     << " without loopback");
+        Ipv4Header header;
+        header.SetSource(source);
+        header.SetDestination(destination);
+        header.SetProtocol(protocol);
+        header.SetPayloadSize(packet->GetSize());
+        DeferredRouteOutput(packet,
+                            header,
+                            MakeCallback(&RoutingProtocol::SendDeferredPacket, this),
+                            MakeCallback(&RoutingProtocol::DropDeferredPacket, this));
+        return;
+    }
+    i->second.second(packet, source, destination, protocol, route);
+}
+
+void
+RoutingProtocol::SendDeferredPacket(Ptr<Ipv4Route> route,
+                                    Ptr<const Packet> p,
+                                    const Ipv4Header& header)
+{
+    NS_LOG_FUNCTION(this << p->GetUid() << header.GetDestination());
+    std::map<uint8_t, std::pair<Ptr<IpL4Protocol>, IpL4Protocol::DownTargetCallback>>::iterator
+        i = m_downTargets.find(header.GetProtocol());
+    NS_ASSERT(i != m_downTargets.end());
+    // IP builds the header now that the route is known
+    Ptr<Packet> copy = p->Copy();
+    i->second.second(copy,
+                     header.GetSource(),
+                     header.GetDestination(),
+                     header.GetProtocol(),
+                     route);
+}
+
+void
+RoutingProtocol::DropDeferredPacket(Ptr<const Packet> p,
+                                    const Ipv4Header& header,
+                                    Socket::SocketErrno err)
+{
+    NS_LOG_DEBUG("Drop deferred packet " << p->GetUid() << " to " << header.GetDestination()
+                                         << " with errno " << err);
+    // Ipv4 reports a packet of the loopback path with the same error as a route error
+    m_dropTrace(header, p, Ipv4L3Protocol::DROP_ROUTE_ERROR, m_ipv4, 0);
+}
+
 void
 RoutingProtocol::SendRerrWhenBreaksLinkToNextHop(Ipv4Address nextHop)
 {
@@ -2087,20 +4508,46 @@ RoutingProtocol::SendRerrWhenBreaksLinkToNextHop(Ipv4Address nextHop)
     toNextHop.GetPrecursors(precursors);
     rerrHeader.AddUnDestination(nextHop, toNextHop.GetSeqNo());
     m_routingTable.GetListOfDestinationWithNextHop(nextHop, unreachable);
+    // Routes with an alternate path fail over to it and are not reported
+    if (m_enableMultipath)
+    {
+        m_routingTable.DeleteAlternatePaths(nextHop);
+        for (std::map<Ipv4Address, uint32_t>::iterator i = unreachable.begin();
+             i != unreachable.end();)
+        {
+            RoutingTableEntry toDst;
+            if (i->first != nextHop && m_routingTable.LookupValidRoute(i->first, toDst) &&
+                toDst.FailOver())
+            {
+                m_routingTable.Update(toDst);
+                unreachable.erase(i++);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+    }
+    // Routes repaired locally are not reported
+    for (std::map<Ipv4Address, uint32_t>::iterator i = unreachable.begin();
+         i != unreachable.end();)
+    {
+        if (i->first != nextHop && LocalRepair(i->first))
+        {
+            unreachable.erase(i++);
+        }
+        else
+        {
+            ++i;
+        }
+    }
     for (std::map<Ipv4Address, uint32_t>::const_iterator i = unreachable.begin();
          i != unreachable.end();)
     {
         if (!rerrHeader.AddUnDestination(i->first, i->second))
         {
             NS_LOG_LOGIC("Send RERR message with maximum size.");
-            TypeHeader typeHeader(MADAODVTYPE_RERR);
-            Ptr<Packet> packet = Create<Packet>();
-            SocketIpTtlTag tag;
-            tag.SetTtl(1);
-            packet->AddPacketTag(tag);
-            packet->AddHeader(rerrHeader);
-            packet->AddHeader(typeHeader);
-            SendRerrMessage(packet, precursors);
+            SendRerrMessage(CreateControlPacket(rerrHeader, MADAODVTYPE_RERR, 1), precursors);
             rerrHeader.Clear();
         }
         else
@@ -2113,14 +4560,7 @@ RoutingProtocol::SendRerrWhenBreaksLinkToNextHop(Ipv4Address nextHop)
     }
     if (rerrHeader.GetDestCount() != 0)
     {
-        TypeHeader typeHeader(MADAODVTYPE_RERR);
-        Ptr<Packet> packet = Create<Packet>();
-        SocketIpTtlTag tag;
-        tag.SetTtl(1);
-        packet->AddPacketTag(tag);
-        packet->AddHeader(rerrHeader);
-        packet->AddHeader(typeHeader);
-        SendRerrMessage(packet, precursors);
+        SendRerrMessage(CreateControlPacket(rerrHeader, MADAODVTYPE_RERR, 1), precursors);
     }
     unreachable.insert(std::make_pair(nextHop, toNextHop.GetSeqNo()));
     m_routingTable.InvalidateRoutesWithDst(unreachable);
@@ -2146,12 +4586,7 @@ RoutingProtocol::SendRerrWhenNoRouteToForward(Ipv4Address dst,
     RerrHeader rerrHeader;
     rerrHeader.AddUnDestination(dst, dstSeqNo);
     RoutingTableEntry toOrigin;
-    Ptr<Packet> packet = Create<Packet>();
-    SocketIpTtlTag tag;
-    tag.SetTtl(1);
-    packet->AddPacketTag(tag);
-    packet->AddHeader(rerrHeader);
-    packet->AddHeader(TypeHeader(MADAODVTYPE_RERR));
+    Ptr<Packet> packet = CreateControlPacket(rerrHeader, MADAODVTYPE_RERR, 1);
     if (m_routingTable.LookupValidRoute(origin, toOrigin))
     {
         Ptr<Socket> socket = FindSocketWithInterfaceAddress(toOrigin.GetInterface());
@@ -2260,7 +4695,7 @@ RoutingProtocol::SendRerrMessage(Ptr<Packet> packet, std::vector<Ipv4Address> pr
         {
             destination = i->GetBroadcast();
         }
-        Simulator::Schedule(Time(MilliSeconds(m_uniformRandomVariable->GetInteger(0, 10))),
+        Simulator::Schedule(GetBroadcastJitter(),
                             &RoutingProtocol::SendTo,
                             this,
                             socket,
@@ -2273,15 +4708,13 @@ Ptr<Socket>
 RoutingProtocol::FindSocketWithInterfaceAddress(Ipv4InterfaceAddress addr) const
 {
     NS_LOG_FUNCTION(this << addr);
-    for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j = m_socketAddresses.begin();
-         j != m_socketAddresses.end();
+    for (std::vector<InterfaceState>::const_iterator j = m_interfaces.begin();
+         j != m_interfaces.end();
          ++j)
     {
-        Ptr<Socket> socket = j->first;
-        Ipv4InterfaceAddress iface = j->second;
-        if (iface == addr)
+        if (j->socket && j->address == addr)
         {
-            return socket;
+            return j->socket;
         }
     }
     Ptr<Socket> socket;
@@ -2292,16 +4725,13 @@ Ptr<Socket>
 RoutingProtocol::FindSubnetBroadcastSocketWithInterfaceAddress(Ipv4InterfaceAddress addr) const
 {
     NS_LOG_FUNCTION(this << addr);
-    for (std::map<Ptr<Socket>, Ipv4InterfaceAddress>::const_iterator j =
-             m_socketSubnetBroadcastAddresses.begin();
-         j != m_socketSubnetBroadcastAddresses.end();
+    for (std::vector<InterfaceState>::const_iterator j = m_interfaces.begin();
+         j != m_interfaces.end();
          ++j)
     {
-        Ptr<Socket> socket = j->first;
-        Ipv4InterfaceAddress iface = j->second;
-        if (iface == addr)
+        if (j->subnetBroadcastSocket && j->address == addr)
         {
-            return socket;
+            return j->subnetBroadcastSocket;
         }
     }
     Ptr<Socket> socket;
@@ -2312,13 +4742,35 @@ void
 RoutingProtocol::DoInitialize()
 {
     NS_LOG_FUNCTION(this);
-    uint32_t startTime;
+    m_currentHelloInterval = m_helloInterval;
+    if (m_enablePreemptiveMaintenance)
+    {
+        m_nb.SetLinkPrediction(m_preemptiveRetryThreshold, m_preemptiveRssiThreshold);
+        m_nb.SetLinkWeakCallback(MakeCallback(&RoutingProtocol::LinkWeak, this));
+    }
     if (m_enableHello)
     {
         m_htimer.SetFunction(&RoutingProtocol::HelloTimerExpire, this);
-        startTime = m_uniformRandomVariable->GetInteger(0, 100);
-        NS_LOG_DEBUG("Starting at time " << startTime << "ms");
-        m_htimer.Schedule(MilliSeconds(startTime));
+        if (m_enableAdaptiveHello)
+        {
+            // Spread the first hellos over a whole interval so that nodes do not stay in sync
+            Time start =
+                Seconds(m_uniformRandomVariable->GetValue(0, m_helloInterval.GetSeconds()));
+            NS_LOG_DEBUG("Starting at time " << start.As(Time::MS));
+            m_htimer.Schedule(start);
+        }
+        else
+        {
+            uint32_t startTime = m_uniformRandomVariable->GetInteger(0, 100);
+            NS_LOG_DEBUG("Starting at time " << startTime << "ms");
+            m_htimer.Schedule(MilliSeconds(startTime));
+        }
+    }
+    if (m_advertiseInterval.IsStrictlyPositive())
+    {
+        m_advertTimer.SetFunction(&RoutingProtocol::AdvertTimerExpire, this);
+        m_advertTimer.Schedule(
+            Seconds(m_uniformRandomVariable->GetValue(0, m_advertiseInterval.GetSeconds())));
     }
     Ipv4RoutingProtocol::DoInitialize();
 }
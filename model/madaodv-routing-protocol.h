@@ -33,23 +33,41 @@
 #include "madaodv-rqueue.h"
 #include "madaodv-rtable.h"
 
+#include "ns3/ip-l4-protocol.h"
 #include "ns3/ipv4-interface.h"
 #include "ns3/ipv4-l3-protocol.h"
 #include "ns3/ipv4-routing-protocol.h"
 #include "ns3/node.h"
 #include "ns3/output-stream-wrapper.h"
 #include "ns3/random-variable-stream.h"
+#include "ns3/traced-callback.h"
 
 #include <map>
+#include <vector>
 
 namespace ns3
 {
 
 class WifiMpdu;
+class WifiTxVector;
+struct MpduInfo;
+struct SignalNoiseDbm;
 enum WifiMacDropReason : uint8_t; // opaque enum declaration
 
 namespace madaodv
 {
+/**
+ * \ingroup madaodv
+ * \brief RREQ rebroadcast suppression schemes
+ */
+enum RreqSuppression
+{
+    RREQ_SUPPRESSION_NONE,     //!< Rebroadcast every new RREQ
+    RREQ_SUPPRESSION_COUNTER,  //!< Cancel the rebroadcast once enough copies were overheard
+    RREQ_SUPPRESSION_GOSSIP,   //!< Rebroadcast with a fixed probability
+    RREQ_SUPPRESSION_COVERAGE, //!< Cancel the rebroadcast once every neighbor has sent the RREQ
+};
+
 /**
  * \ingroup madaodv
  *
@@ -193,6 +211,57 @@ class RoutingProtocol : public Ipv4RoutingProtocol
         return m_enableBroadcast;
     }
 
+    /**
+     * Set the weight of the newest sample in the link lifetime moving average
+     * \param weight the weight
+     */
+    void SetLinkLifetimeWeight(double weight);
+
+    /**
+     * Get the weight of the newest sample in the link lifetime moving average
+     * \returns the weight
+     */
+    double GetLinkLifetimeWeight() const
+    {
+        return m_nb.GetLinkLifetimeWeight();
+    }
+
+    /**
+     * Start a route discovery ahead of the first packet to a destination, unless a valid route
+     * exists or a discovery is running. The RouteState trace reports the outcome. Nothing is
+     * started while no interface runs MADAODV.
+     * \param dst the destination address
+     * \returns true if a valid route to the destination exists and MADAODV runs on an interface
+     */
+    bool RequestRoute(Ipv4Address dst);
+
+    /**
+     * Answer route requests for every node of a subnet this node is the border node of, e.g. the
+     * subnet behind a gateway. The RREPs carry the prefix size, so that the requesting nodes
+     * install a single route to the whole subnet.
+     * \param network the subnet address
+     * \param mask the subnet mask, its prefix length must be in [1, 31]
+     */
+    void AddHostedPrefix(Ipv4Address network, Ipv4Mask mask);
+
+    /**
+     * Look for routes to a destination which meet QoS bounds. The RREQs to the destination carry
+     * the bounds, each node drops them if its own hop cannot meet them, and only the destination
+     * replies. A discovery which finds no such path fails. Routes found before are kept.
+     * \param dst the destination address
+     * \param maxDelay the end-to-end delay bound, 0 for none
+     * \param minBandwidth the bit rate each link must offer, 0 for none. Both bounds 0 remove the
+     *        requirement.
+     */
+    void SetQosRequirement(Ipv4Address dst, Time maxDelay, DataRate minBandwidth);
+
+    /**
+     * TracedCallback signature for route state changes
+     * \param [in] dst the destination address
+     * \param [in] valid whether a valid route to the destination exists
+     */
+    typedef void (*RouteStateTracedCallback)(Ipv4Address dst, bool valid);
+
     /**
      * Assign a fixed random variable stream number to the random variables
      * used by this model.  Return the number of streams (possibly zero) that
@@ -214,6 +283,75 @@ class RoutingProtocol : public Ipv4RoutingProtocol
      * \param mpdu the dropped MPDU
      */
     void NotifyTxError(WifiMacDropReason reason, Ptr<const WifiMpdu> mpdu);
+    /**
+     * Notify that a MAC transmission attempt failed and is going to be retried.
+     *
+     * \param addr the MAC address of the receiver
+     */
+    void NotifyTxRetry(Mac48Address addr);
+    /**
+     * Recover the IP packet of a data MPDU dropped at the MAC and send it again, on another
+     * route if one is valid, or once the route was rediscovered. Called after the link break
+     * was processed: the routes over the broken link are already invalid or failed over, and
+     * the RERR for them is sent.
+     *
+     * \param mpdu the dropped MPDU
+     */
+    void SalvageMpdu(Ptr<const WifiMpdu> mpdu);
+    /**
+     * Send a salvaged packet, which already carries its IP header
+     * \param route the route
+     * \param p the packet, without IP header
+     * \param header the IP header of the packet
+     */
+    void SalvageSend(Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header& header);
+    /**
+     * Drop a salvaged packet which could not be sent again, reports the drop on the Drop trace
+     * \param p the packet, without IP header
+     * \param header the IP header of the packet
+     * \param err the error
+     */
+    void SalvageDrop(Ptr<const Packet> p, const Ipv4Header& header, Socket::SocketErrno err);
+    /**
+     * Notify that an MPDU was acknowledged.
+     *
+     * \param mpdu the acknowledged MPDU
+     */
+    void NotifyTxAcked(Ptr<const WifiMpdu> mpdu);
+    /**
+     * Notify that the PHY received a frame, whatever its receiver.
+     *
+     * \param packet the received frame
+     * \param channelFreqMhz the frequency of the channel
+     * \param txVector the TXVECTOR of the frame
+     * \param aMpdu the A-MPDU information of the frame
+     * \param signalNoise the signal and noise power of the frame
+     * \param staId the STA-ID of the receiver
+     */
+    void NotifyRxSignal(Ptr<const Packet> packet,
+                        uint16_t channelFreqMhz,
+                        WifiTxVector txVector,
+                        MpduInfo aMpdu,
+                        SignalNoiseDbm signalNoise,
+                        uint16_t staId);
+    /**
+     * Learn from a MADAODV message overheard while unicast to another node
+     * \param packet the frame body, starting at the LLC header
+     */
+    void ProcessOverheard(Ptr<Packet> packet);
+    /**
+     * Learn the route advertised by an overheard RREP
+     * \param p the packet, starting at the RREP header
+     * \param transmitter the neighbor which sent the RREP
+     */
+    void OverhearReply(Ptr<Packet> p, Ipv4Address transmitter);
+    /**
+     * Install a route learned without a RREQ of this node, if it is fresher or shorter than the
+     * known one. A route discovery running for the destination is then over.
+     * \param newEntry the route, the precursors of the known route are added to it
+     * \returns true if the route was installed
+     */
+    bool AcceptRoute(RoutingTableEntry& newEntry);
 
     // Protocol parameters.
     uint32_t m_rreqRetries; ///< Maximum number of retransmissions of RREQ with TTL = NetDiameter to
@@ -237,12 +375,18 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     Time m_netTraversalTime;  ///< Estimate of the average net traversal time.
     Time m_pathDiscoveryTime; ///< Estimate of maximum time needed to find route in network.
     Time m_myRouteTimeout;    ///< Value of lifetime field in RREP generating by this node.
+    bool m_enableAdaptiveRouteTimeout; ///< Indicates whether route lifetimes follow link lifetimes
+    Time m_minActiveRouteTimeout;      ///< Lower bound of the adaptive active route lifetime
+    Time m_maxActiveRouteTimeout;      ///< Upper bound of the adaptive active route lifetime
     /**
      * Every HelloInterval the node checks whether it has sent a broadcast  within the last
      * HelloInterval. If it has not, it MAY broadcast a  Hello message
      */
     Time m_helloInterval;
     uint32_t m_allowedHelloLoss; ///< Number of hello messages which may be loss for valid link
+    bool m_enableAdaptiveHello;  ///< Indicates whether the hello interval adapts to neighbor churn
+    Time m_maxHelloInterval;     ///< Upper bound of the adaptive hello interval
+    Time m_currentHelloInterval; ///< Interval until the next hello message
     /**
      * DeletePeriod is intended to provide an upper bound on the time for which an upstream node A
      * can have a neighbor B as an active next hop for destination D, while B has invalidated the
@@ -260,6 +404,44 @@ class RoutingProtocol : public Ipv4RoutingProtocol
                              ///< originated route discovery.
     bool m_enableHello;      ///< Indicates whether a hello messages enable
     bool m_enableBroadcast;  ///< Indicates whether a a broadcast data packets forwarding enable
+    bool m_enableDirectDeferral; ///< Indicates whether packets without a route are queued directly
+                                 ///< from the transport layer instead of via the loopback device
+    RreqSuppression m_rreqSuppression; ///< RREQ rebroadcast suppression scheme
+    uint32_t m_rreqSuppressionCounter; ///< Number of overheard copies cancelling a rebroadcast
+    double m_rreqGossipProbability;    ///< Rebroadcast probability of the gossip scheme
+    uint32_t m_rreqGossipHops; ///< Hop count up to which the gossip scheme always rebroadcasts
+    bool m_enableLocalRepair;  ///< Indicates whether intermediate nodes repair broken routes
+    uint16_t m_maxRepairTtl;   ///< Maximum hop count to a destination for local repair
+    uint16_t m_localAddTtl;    ///< TTL added to the last known hop count in a local repair RREQ
+    bool m_enableMultipath;    ///< Indicates whether alternate paths are kept for fast failover
+    uint32_t m_maxPaths;       ///< Maximum number of paths per destination, the route included
+    bool m_enableStriping;     ///< Indicates whether flows are spread over the alternate paths
+    bool m_enablePreemptiveMaintenance; ///< Indicates whether routes over a link predicted to
+                                        ///< fail are rediscovered in the background
+    uint32_t m_preemptiveRetryThreshold; ///< Consecutive MAC failures predicting a link failure
+    double m_preemptiveRssiThreshold; ///< Signal strength in dBm below which a fading link is
+                                      ///< predicted to fail
+    bool m_enableSalvage; ///< Indicates whether packets dropped at the MAC are sent again
+    bool m_enablePiggyback; ///< Indicates whether unicast packets carry route refresh and RREP_ACK
+    bool m_enableHelloNeighborSet; ///< Indicates whether hellos carry the heard neighbor set
+    Time m_rreqAggregationWindow;  ///< Time route discoveries are collected into one RREQ
+    bool m_enablePathAccumulation; ///< Indicates whether RREQ and RREP accumulate their path
+    uint32_t m_maxPathLength;      ///< Maximum number of addresses accumulated in a path
+    bool m_enablePromiscuousLearning; ///< Indicates whether overheard RREP and RERR are processed
+    Time m_advertiseInterval; ///< Interval between the route advertisements of this node
+    uint32_t m_advertId;      ///< ID of the last route advertisement of this node
+    /// ID of the last route advertisement processed, per advertised destination
+    std::map<Ipv4Address, uint32_t> m_advertIds;
+    /// Subnets this node answers route requests for
+    std::vector<std::pair<Ipv4Address, Ipv4Mask>> m_hostedPrefixes;
+    /// QoS bounds of the route discoveries per destination
+    std::map<Ipv4Address, QosExtension> m_qosRequirements;
+    Time m_rreqHoldTime; ///< Time the copies of a RREQ are compared to select the reverse route
+    Time m_jitterPerNeighbor;    ///< Width of the broadcast jitter window per neighbor
+    Time m_maxJitter;            ///< Maximum width of the scaled broadcast jitter window
+    bool m_enableJitterRssiBias; ///< Indicates whether weak senders make rebroadcasts go first
+    bool m_enableLoadAwareness;  ///< Indicates whether RREQs accumulate the load of their path
+    uint32_t m_loadPerHop;       ///< Queued frames along a path weighing as much as one hop
 
     /// IP protocol
     Ptr<Ipv4> m_ipv4;
@@ -271,6 +453,22 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     /// Loopback device used to defer RREQ until packet will be fully formed
     Ptr<NetDevice> m_lo;
 
+    /// MADAODV state of one IP interface
+    struct InterfaceState
+    {
+        Ptr<Socket> socket;                ///< Raw unicast socket, null if MADAODV is not running
+        Ptr<Socket> subnetBroadcastSocket; ///< Raw subnet directed broadcast socket
+        Ipv4InterfaceAddress address;      ///< Interface address (IP + mask)
+        std::vector<uint8_t> hello;        ///< Serialized hello message sent on this interface
+    };
+
+    /// Per-interface lookup table indexed by IP interface index, rebuilt from the socket maps
+    std::vector<InterfaceState> m_interfaces;
+    /// Transport protocols intercepted for direct deferral, map protocol number -> (protocol,
+    /// original down target)
+    std::map<uint8_t, std::pair<Ptr<IpL4Protocol>, IpL4Protocol::DownTargetCallback>>
+        m_downTargets;
+
     /// Routing table
     RoutingTable m_routingTable;
     /// A "drop-front" queue used by the routing layer to buffer packets to which it does not have a
@@ -291,9 +489,58 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     /// Number of RERRs used for RERR rate control
     uint16_t m_rerrCount;
 
+    /// RREQ waiting for its rebroadcast jitter to expire
+    struct PendingRreq
+    {
+        Ptr<Packet> packet;              ///< RREQ to rebroadcast
+        uint32_t copies;                 ///< Number of duplicates overheard meanwhile
+        std::vector<Ipv4Address> heard;  ///< Neighbors the RREQ was received from
+        EventId event;                   ///< Rebroadcast event
+    };
+
+    /// Rebroadcasts which may still be suppressed, map (origin, RREQ ID) -> pending RREQ
+    std::map<std::pair<Ipv4Address, uint32_t>, PendingRreq> m_pendingRreq;
+
+    /// RREQ whose later copies may still give a better reverse route
+    struct HeldRreq
+    {
+        uint32_t cost;      ///< Cost of the reverse route through the best copy so far
+        bool replyPending;  ///< Indicates whether this node answers the RREQ when the window closes
+        RreqHeader request; ///< RREQ to answer
+        uint8_t prefixSize; ///< Prefix size of the RREP, 0 for this node only
+        /// Neighbors of the alternate paths to answer when the window closes
+        std::vector<Ipv4Address> alternates;
+        EventId event; ///< End of the holding window
+    };
+
+    /// RREQs in their holding window, map (origin, RREQ ID) -> held RREQ
+    std::map<std::pair<Ipv4Address, uint32_t>, HeldRreq> m_heldRreq;
+
+    /// Route being repaired locally
+    struct LocalRepairState
+    {
+        uint16_t hops;                       ///< Hop count to the destination before the break
+        std::vector<Ipv4Address> precursors; ///< Precursors of the broken route
+    };
+
+    /// Routes being repaired locally, map destination -> repair state
+    std::map<Ipv4Address, LocalRepairState> m_localRepair;
+    /// Time until which no new background discovery is started per destination
+    std::map<Ipv4Address, Time> m_preemptiveHoldDown;
+    /// Destinations of the route discoveries collected into the next aggregated RREQ
+    std::vector<Ipv4Address> m_aggregatedRequests;
+    /// Sends the aggregated RREQ at the end of the aggregation window
+    EventId m_aggregationEvent;
+    /// RREP_ACK waiting for a packet to the neighbor to be piggybacked on, per neighbor
+    std::map<Ipv4Address, EventId> m_pendingAck;
+    /// Time a piggybacked packet was last sent, per next hop
+    std::map<Ipv4Address, Time> m_piggybackTime;
+
   private:
     /// Start protocol operation
     void Start();
+    /// Rebuild the per-interface lookup table after the socket maps changed
+    void UpdateInterfaceTable();
     /**
      * Queue packet and send route request
      *
@@ -306,6 +553,40 @@ class RoutingProtocol : public Ipv4RoutingProtocol
                              const Ipv4Header& header,
                              UnicastForwardCallback ucb,
                              ErrorCallback ecb);
+    /// Interpose on the down targets of the transport protocols for direct deferral
+    void InstallDirectDeferral();
+    /**
+     * Down target of the intercepted transport protocols. Packets routed to the loopback
+     * route by RouteOutput are queued here directly, everything else is passed on to IP.
+     *
+     * \param packet the transport layer packet
+     * \param source the source address
+     * \param destination the destination address
+     * \param protocol the transport protocol number
+     * \param route the route returned by RouteOutput
+     */
+    void DirectDeferralSend(Ptr<Packet> packet,
+                            Ipv4Address source,
+                            Ipv4Address destination,
+                            uint8_t protocol,
+                            Ptr<Ipv4Route> route);
+    /**
+     * Hand a directly deferred packet back to its transport protocol down target once a route
+     * has been found.
+     *
+     * \param route the route to use
+     * \param p the transport layer packet
+     * \param header the IP header stored in the queue
+     */
+    void SendDeferredPacket(Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header& header);
+    /**
+     * Error callback for directly deferred packets, reports the drop on the Drop trace.
+     *
+     * \param p the dropped packet
+     * \param header the IP header stored in the queue
+     * \param err the socket error
+     */
+    void DropDeferredPacket(Ptr<const Packet> p, const Ipv4Header& header, Socket::SocketErrno err);
     /**
      * If route exists and is valid, forward packet.
      *
@@ -360,6 +641,53 @@ class RoutingProtocol : public Ipv4RoutingProtocol
      * \returns the socket associated with the interface
      */
     Ptr<Socket> FindSubnetBroadcastSocketWithInterfaceAddress(Ipv4InterfaceAddress iface) const;
+    /**
+     * Piggyback the route refresh, and a pending RREP_ACK, on a unicast packet
+     * \param p the packet
+     * \param route the route of the packet
+     */
+    void AttachPiggyback(Ptr<const Packet> p, Ptr<Ipv4Route> route);
+    /**
+     * Settle the pending RREP_ACK and note the refresh of the next hop when a packet carrying
+     * piggybacked information is handed to the device
+     * \param packet the packet, with IP header
+     * \param ipv4 the Ipv4 of the node
+     * \param interface the output interface
+     */
+    void NotifyPiggybackTx(Ptr<const Packet> packet, Ptr<Ipv4> ipv4, uint32_t interface);
+    /**
+     * Process the route refresh and RREP_ACK piggybacked on a received packet
+     * \param p the packet
+     * \param iif the input interface
+     * \returns the packet to forward or deliver, a copy without the tag if it carried one
+     */
+    Ptr<const Packet> ProcessPiggyback(Ptr<const Packet> p, int32_t iif);
+    /**
+     * Delay a RREP_ACK in the hope of piggybacking it on a packet to the neighbor
+     * \param neighbor the neighbor which sent the RREP
+     */
+    void DeferReplyAck(Ipv4Address neighbor);
+    /**
+     * Send a deferred RREP_ACK which could not be piggybacked
+     * \param neighbor the neighbor which sent the RREP
+     */
+    void SendPendingReplyAck(Ipv4Address neighbor);
+    /**
+     * Check whether every neighbor received a piggybacked packet within the last HelloInterval
+     * \returns true if a HELLO would not tell the neighbors anything new
+     */
+    bool NeighborsCoveredByPiggyback();
+    /**
+     * Process the extensions of a hello message
+     * \param p the packet, starting at the first extension
+     * \param sender the sender of the hello
+     * \param receiver the receiver interface address
+     * \param known whether the sender was a neighbor before this hello
+     */
+    void ProcessHelloExtensions(Ptr<const Packet> p,
+                                Ipv4Address sender,
+                                Ipv4Address receiver,
+                                bool known);
     /**
      * Process hello message
      *
@@ -420,27 +748,99 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     /** Forward packet from route request queue
      * \param dst destination address
      * \param route route to use
+     * \param mask forward the packets to every destination of this subnet of dst
      */
-    void SendPacketFromQueue(Ipv4Address dst, Ptr<Ipv4Route> route);
+    void SendPacketFromQueue(Ipv4Address dst,
+                             Ptr<Ipv4Route> route,
+                             Ipv4Mask mask = Ipv4Mask::GetOnes());
     /// Send hello
     void SendHello();
     /** Send RREQ
      * \param dst destination address
      */
     void SendRequest(Ipv4Address dst);
+    /// Send the RREQs of the route discoveries collected during the aggregation window
+    void SendAggregatedRequest();
+    /**
+     * Fill the RREQ fields of a new route discovery and mark the route as being searched
+     * \param dst destination address
+     * \param rreqHeader the RREQ to fill
+     * \returns the TTL of the RREQ according to the expanding ring search
+     */
+    uint16_t PrepareRequest(Ipv4Address dst, RreqHeader& rreqHeader);
+    /**
+     * Broadcast a new RREQ originated by this node on all interfaces
+     * \param rreqHeader the RREQ, the originator address is set per interface
+     * \param ttl the RREQ TTL
+     * \param extensions the serialized extensions of the RREQ, if any
+     * \returns false if no interface meets the QoS bounds of the destination, no RREQ is sent
+     */
+    bool BroadcastNewRequest(RreqHeader& rreqHeader,
+                             uint16_t ttl,
+                             Ptr<const Packet> extensions = nullptr);
+    /**
+     * Test whether a route broken at this node may be repaired locally
+     * \param rt the broken route
+     * \returns true if local repair is enabled and applies to the route
+     */
+    bool IsRepairable(const RoutingTableEntry& rt) const;
+    /**
+     * Start local repair of a broken route: send a TTL limited RREQ and buffer the packets
+     * forwarded to the destination meanwhile
+     * \param dst the destination of the broken route
+     * \returns true if the route is repairable and the RREQ rate limit allowed the repair
+     */
+    bool LocalRepair(Ipv4Address dst);
+    /**
+     * Give up local repair if no route was found
+     * \param dst the destination of the broken route
+     */
+    void LocalRepairTimerExpire(Ipv4Address dst);
+    /**
+     * Complete local repair once a RREP for the destination was received
+     * \param dst the destination of the repaired route
+     */
+    void LocalRepairDone(Ipv4Address dst);
+    /**
+     * Get the lifetime granted to an active route through the given next hop
+     * \param nextHop the next hop of the route
+     * \returns ActiveRouteTimeout, or the bounded link lifetime estimate in adaptive mode
+     */
+    Time GetActiveRouteTimeout(Ipv4Address nextHop);
+    /**
+     * Get the lifetime advertised in a RREP generated by this node
+     * \param nextHop the next hop towards the originator of the RREQ
+     * \returns MyRouteTimeout, or its adaptive equivalent
+     */
+    Time GetMyRouteTimeout(Ipv4Address nextHop);
+    /**
+     * Start a background rediscovery of the routes over a link predicted to fail
+     * \param nextHop the neighbor at the other end of the link
+     */
+    void LinkWeak(Ipv4Address nextHop);
+    /**
+     * Look for a replacement of a valid route without disturbing its use
+     * \param dst the destination of the route
+     */
+    void PreemptiveRequest(Ipv4Address dst);
     /** Send RREP
      * \param rreqHeader route request header
      * \param toOrigin routing table entry to originator
+     * \param prefixSize the prefix size of the subnet answered for, 0 for this node only
      */
-    void SendReply(const RreqHeader& rreqHeader, const RoutingTableEntry& toOrigin);
+    void SendReply(const RreqHeader& rreqHeader,
+                   const RoutingTableEntry& toOrigin,
+                   uint8_t prefixSize = 0);
     /** Send RREP by intermediate node
      * \param toDst routing table entry to destination
      * \param toOrigin routing table entry to originator
      * \param gratRep indicates whether a gratuitous RREP should be unicast to destination
+     * \param dst the destination of the RREQ, a host of the subnet if toDst is a subnet route
      */
     void SendReplyByIntermediateNode(RoutingTableEntry& toDst,
                                      RoutingTableEntry& toOrigin,
-                                     bool gratRep);
+                                     bool gratRep,
+                                     Ipv4Address dst);
     /** Send RREP_ACK
      * \param neighbor neighbor address
      */
@@ -464,6 +864,197 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     void SendRerrWhenNoRouteToForward(Ipv4Address dst, uint32_t dstSeqNo, Ipv4Address origin);
     /** @} */
 
+    /**
+     * Select the route of a packet. Without striping this is the route of the entry, otherwise
+     * the flow of the packet is pinned to one of the usable paths.
+     * \param rt the routing table entry to the destination
+     * \param p the packet, without IP header
+     * \param header the IP header of the packet
+     * \param local whether the packet is being originated, in RouteOutput
+     * \returns the route
+     */
+    Ptr<Ipv4Route> SelectRoute(const RoutingTableEntry& rt,
+                               Ptr<const Packet> p,
+                               const Ipv4Header& header,
+                               bool local) const;
+    /**
+     * Hash the flow of a packet: addresses, protocol and, for unfragmented TCP and UDP packets
+     * starting with their transport header, ports
+     * \param p the packet, without IP header
+     * \param header the IP header of the packet
+     * \param source the source address of the flow
+     * \param ports whether the packet starts with its transport header
+     * \returns the flow hash
+     */
+    uint32_t FlowHash(Ptr<const Packet> p,
+                      const Ipv4Header& header,
+                      Ipv4Address source,
+                      bool ports) const;
+    /**
+     * Learn an alternate reverse path from a duplicate RREQ. The destination of the RREQ answers
+     * each copy providing a new path, so that the nodes on the way back learn alternate forward
+     * paths. In the holding window of the RREQ, these RREPs are deferred with the RREP of the
+     * best copy.
+     * \param rreqHeader the duplicate RREQ
+     * \param receiver the address of the receiving interface
+     * \param src the neighbor the duplicate was received from
+     */
+    void RecvAlternateRequest(const RreqHeader& rreqHeader, Ipv4Address receiver, Ipv4Address src);
+    /**
+     * Rebroadcast a RREQ, applying the configured suppression scheme
+     * \param rreqHeader the RREQ to rebroadcast
+     * \param ttl the IP TTL to send the RREQ with
+     * \param src the neighbor the RREQ was received from
+     * \param extensions the serialized extensions of the RREQ, if any
+     */
+    void ForwardRequest(const RreqHeader& rreqHeader,
+                        uint8_t ttl,
+                        Ipv4Address src,
+                        Ptr<const Packet> extensions = nullptr);
+    /**
+     * Reply to a RREQ for one destination if this node is the destination or knows a fresh
+     * enough route to it
+     * \param rreqHeader the RREQ, its destination sequence number is raised to the one known by
+     *        this node if the RREQ goes on
+     * \param src the neighbor the RREQ was received from
+     * \returns true if the RREQ needs not be forwarded for this destination
+     */
+    bool AnswerRequest(RreqHeader& rreqHeader, Ipv4Address src);
+    /**
+     * Find the longest subnet hosted by this node holding a destination
+     * \param dst the destination address
+     * \returns the prefix length of the subnet, 0 if no hosted subnet holds dst
+     */
+    uint8_t GetHostedPrefixSize(Ipv4Address dst) const;
+    /**
+     * Create or update the reverse route to the originator of a RREQ
+     * \param rreqHeader the RREQ, its hop count already counting the last hop
+     * \param receiver the interface address the RREQ was received on
+     * \param src the neighbor the RREQ was received from
+     */
+    void UpdateReverseRoute(const RreqHeader& rreqHeader, Ipv4Address receiver, Ipv4Address src);
+    /**
+     * Rate the reverse route a copy of a RREQ offers, the lower the better
+     * \param hops the hop count of the copy, counting the last hop
+     * \param src the neighbor the copy was received from
+     * \param load the number of frames queued along the path of the copy
+     * \returns the cost of the reverse route
+     */
+    uint32_t ReverseRouteCost(uint8_t hops, Ipv4Address src, uint32_t load) const;
+    /**
+     * Count the frames waiting in the Wi-Fi MAC queues of an interface
+     * \param iface the interface address
+     * \returns the number of queued frames, 0 for other devices
+     */
+    uint32_t GetQueueLoad(Ipv4Address iface) const;
+    /**
+     * Get the bit rate of the Wi-Fi interface at the default mode of its PHY, not at the data mode
+     * the rate manager currently uses
+     * \param iface the interface address
+     * \returns the bit rate, 0 for other devices
+     */
+    uint64_t GetLinkRate(Ipv4Address iface) const;
+    /**
+     * Check that the hop of this node on an interface meets the QoS bounds of a RREQ and spend
+     * its estimated delay from the delay bound. The delay estimate is the time to send the queued
+     * frames and one more at the link rate.
+     * \param qos the QoS bounds, the delay bound is reduced on success
+     * \param iface the interface address
+     * \returns false if the bounds cannot be met
+     */
+    bool ApplyQos(QosExtension& qos, Ipv4Address iface) const;
+    /**
+     * Switch the reverse route to a duplicate RREQ received in the holding window if it offers a
+     * cheaper one
+     * \param rreqHeader the duplicate RREQ
+     * \param receiver the interface address the RREQ was received on
+     * \param src the neighbor the RREQ was received from
+     * \param load the number of frames queued along the path of the RREQ
+     */
+    void RecvBetterRequest(const RreqHeader& rreqHeader,
+                           Ipv4Address receiver,
+                           Ipv4Address src,
+                           uint32_t load);
+    /**
+     * Defer the RREP of the destination to the end of the holding window of the RREQ
+     * \param rreqHeader the RREQ to answer
+     * \param prefixSize the prefix size of the RREP
+     * \param alternate the neighbor of the alternate path to answer on, if the RREP answers a
+     * duplicate RREQ in multipath mode
+     * \returns true if the RREP is deferred, false if it has to be sent at once
+     */
+    bool HoldReply(const RreqHeader& rreqHeader,
+                   uint8_t prefixSize,
+                   Ipv4Address alternate = Ipv4Address());
+    /**
+     * Close the holding window of a RREQ and send the deferred RREP, if any
+     * \param origin the originator of the RREQ
+     * \param id the RREQ ID
+     */
+    void HeldRequestExpire(Ipv4Address origin, uint32_t id);
+    /**
+     * Append this node to the path accumulated by a RREQ or RREP it forwards
+     * \param path the accumulated path
+     * \param node the address of this node
+     * \returns false if the path reached its maximum length and must be dropped
+     */
+    bool ExtendPath(PathExtension& path, Ipv4Address node) const;
+    /**
+     * Install routes to the nodes of the path accumulated by a RREQ or RREP
+     * \param path the accumulated path, its last node is the sender
+     * \param sender the neighbor the message was received from
+     * \param receiver the receiver interface address
+     */
+    void LearnPath(const PathExtension& path, Ipv4Address sender, Ipv4Address receiver);
+    /**
+     * Find an extension among those following a message
+     * \param p the packet, starting at the first extension
+     * \param type the extension type
+     * \param extension the extension to fill
+     * \returns true if the extension was found
+     */
+    bool PeekExtension(Ptr<const Packet> p, uint8_t type, Header& extension) const;
+    /**
+     * Account for a duplicate of a RREQ whose rebroadcast is pending
+     * \param origin the RREQ originator
+     * \param id the RREQ ID
+     * \param src the neighbor the duplicate was received from
+     */
+    void RecvDuplicateRequest(Ipv4Address origin, uint32_t id, Ipv4Address src);
+    /**
+     * Rebroadcast a pending RREQ unless it has been suppressed meanwhile
+     * \param origin the RREQ originator
+     * \param id the RREQ ID
+     */
+    void PendingRequestExpire(Ipv4Address origin, uint32_t id);
+    /**
+     * Broadcast a flooded message, a RREQ or a route advertisement, on all interfaces
+     * \param rreq the message packet
+     * \param jitter whether each interface waits for its own random jitter
+     * \param src the neighbor the message was received from, if it is rebroadcast
+     */
+    void BroadcastRequest(Ptr<Packet> rreq, bool jitter, Ipv4Address src = Ipv4Address());
+    /**
+     * Draw the random jitter of a control broadcast. The window is 10 ms, or scaled to the number
+     * of neighbors with JitterPerNeighbor.
+     * \param src the neighbor a rebroadcast message was received from, to bias the jitter by its
+     *        signal strength
+     * \returns the jitter
+     */
+    Time GetBroadcastJitter(Ipv4Address src = Ipv4Address());
+
+    /**
+     * Create a control packet carrying a single MADAODV message
+     * \param header the message header
+     * \param type the message type
+     * \param ttl the IP TTL to send the packet with
+     * \param extensions the serialized extensions following the message, if any
+     * \returns the packet
+     */
+    Ptr<Packet> CreateControlPacket(const Header& header,
+                                    MessageType type,
+                                    uint8_t ttl,
+                                    Ptr<const Packet> extensions = nullptr) const;
     /**
      * Send packet to destination socket
      * \param socket destination node socket
@@ -476,6 +1067,8 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     Timer m_htimer;
     /// Schedule next send of hello message
     void HelloTimerExpire();
+    /// Reset the adaptive hello interval when a neighbor appears or disappears
+    void NeighborChange();
     /// RREQ rate limit timer
     Timer m_rreqRateLimitTimer;
     /// Reset RREQ count and schedule RREQ rate limit timer with delay 1 sec.
@@ -484,6 +1077,23 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     Timer m_rerrRateLimitTimer;
     /// Reset RERR count and schedule RERR rate limit timer with delay 1 sec.
     void RerrRateLimitTimerExpire();
+    /// Route advertisement timer
+    Timer m_advertTimer;
+    /// Send a route advertisement and schedule the next one
+    void AdvertTimerExpire();
+    /// Flood a route advertisement for the addresses of this node
+    void SendAdvertisement();
+    /**
+     * Receive a route advertisement, learn the route and flood it further
+     * \param p the packet, after the RREP header
+     * \param rrepHeader the advertisement, with the hop count already incremented
+     * \param receiver the receiver interface address
+     * \param sender the neighbor the advertisement was received from
+     */
+    void RecvAdvertisement(Ptr<Packet> p,
+                           RrepHeader& rrepHeader,
+                           Ipv4Address receiver,
+                           Ipv4Address sender);
     /// Map IP address + RREQ timer.
     std::map<Ipv4Address, Timer> m_addressReqTimer;
     /**
@@ -491,6 +1101,12 @@ class RoutingProtocol : public Ipv4RoutingProtocol
      * \param dst the destination IP address
      */
     void RouteRequestTimerExpire(Ipv4Address dst);
+    /**
+     * End the route discoveries for the hosts of a subnet and send their queued packets, once a
+     * route to the subnet is known
+     * \param toSubnet the subnet route
+     */
+    void SubnetRouteFound(const RoutingTableEntry& toSubnet);
     /**
      * Mark link to neighbor node as unidirectional for blacklistTimeout
      *
@@ -503,6 +1119,27 @@ class RoutingProtocol : public Ipv4RoutingProtocol
     Ptr<UniformRandomVariable> m_uniformRandomVariable;
     /// Keep track of the last bcast time
     Time m_lastBcastTime;
+    /// Trace fired when a route becomes valid or invalid, or when a route discovery fails
+    TracedCallback<Ipv4Address, bool> m_routeStateTrace;
+    /// Trace fired when a packet buffered by the protocol outside of the IP layer is dropped
+    TracedCallback<const Ipv4Header&,
+                   Ptr<const Packet>,
+                   Ipv4L3Protocol::DropReason,
+                   Ptr<Ipv4>,
+                   uint32_t>
+        m_dropTrace;
+    /**
+     * Report a route state change of the routing table
+     * \param dst the destination address
+     * \param valid whether the route is valid
+     */
+    void RouteStateChanged(Ipv4Address dst, bool valid);
+    /**
+     * Fire the route state trace
+     * \param dst the destination address
+     * \param valid whether the route is valid
+     */
+    void NotifyRouteState(Ipv4Address dst, bool valid);
 };
 
 } // namespace madaodv
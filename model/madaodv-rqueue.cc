@@ -89,11 +89,17 @@ RequestQueue::DropPacketWithDst(Ipv4Address dst)
 
 bool
 RequestQueue::Dequeue(Ipv4Address dst, QueueEntry& entry)
+{
+    return Dequeue(dst, Ipv4Mask::GetOnes(), entry);
+}
+
+bool
+RequestQueue::Dequeue(Ipv4Address dst, Ipv4Mask mask, QueueEntry& entry)
 {
     Purge();
     for (std::vector<QueueEntry>::iterator i = m_queue.begin(); i != m_queue.end(); ++i)
     {
-        if (i->GetIpv4Header().GetDestination() == dst)
+        if (mask.IsMatch(i->GetIpv4Header().GetDestination(), dst))
         {
             entry = *i;
             m_queue.erase(i);
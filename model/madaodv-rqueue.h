@@ -223,6 +223,15 @@ class RequestQueue
      * \returns true if the entry is dequeued
      */
     bool Dequeue(Ipv4Address dst, QueueEntry& entry);
+    /**
+     * Return first found (the earliest) entry for a destination in a subnet
+     *
+     * \param dst the subnet address
+     * \param mask the subnet mask
+     * \param entry the queue entry
+     * \returns true if the entry is dequeued
+     */
+    bool Dequeue(Ipv4Address dst, Ipv4Mask mask, QueueEntry& entry);
     /**
      * Remove all packets with destination IP address dst
      * \param dst the destination IP address
@@ -57,6 +57,7 @@ RoutingTableEntry::RoutingTableEntry(Ptr<NetDevice> dev,
       m_validSeqNo(vSeqNo),
       m_seqNo(seqNo),
       m_hops(hops),
+      m_prefixSize(0),
       m_lifeTime(lifetime + Simulator::Now()),
       m_iface(iface),
       m_flag(VALID),
@@ -75,6 +76,24 @@ RoutingTableEntry::~RoutingTableEntry()
 {
 }
 
+void
+RoutingTableEntry::SetPrefixSize(uint8_t prefixSize)
+{
+    NS_ASSERT(prefixSize < 32);
+    m_prefixSize = prefixSize;
+    m_ipv4Route->SetDestination(GetDestination().CombineMask(GetPrefixMask()));
+}
+
+Ipv4Mask
+RoutingTableEntry::GetPrefixMask() const
+{
+    if (m_prefixSize == 0)
+    {
+        return Ipv4Mask::GetOnes();
+    }
+    return Ipv4Mask(0xffffffff << (32 - m_prefixSize));
+}
+
 bool
 RoutingTableEntry::InsertPrecursor(Ipv4Address id)
 {
@@ -167,6 +186,131 @@ RoutingTableEntry::GetPrecursors(std::vector<Ipv4Address>& prec) const
     }
 }
 
+bool
+RoutingTableEntry::InsertAlternatePath(Ipv4Address nextHop,
+                                       Ptr<NetDevice> dev,
+                                       Ipv4InterfaceAddress iface,
+                                       uint16_t hops,
+                                       Time lifetime,
+                                       uint32_t maxPaths)
+{
+    NS_LOG_FUNCTION(this << nextHop << hops);
+    if (m_flag != VALID || nextHop == GetNextHop() || hops > m_hops)
+    {
+        return false;
+    }
+    // Paths learned with an older sequence number may lead to stale routes
+    m_alternatePaths.erase(std::remove_if(m_alternatePaths.begin(),
+                                          m_alternatePaths.end(),
+                                          [this](const AlternatePath& p) {
+                                              return p.seqNo != m_seqNo ||
+                                                     p.expire < Simulator::Now();
+                                          }),
+                           m_alternatePaths.end());
+    for (std::vector<AlternatePath>::iterator i = m_alternatePaths.begin();
+         i != m_alternatePaths.end();
+         ++i)
+    {
+        if (i->nextHop == nextHop)
+        {
+            i->dev = dev;
+            i->iface = iface;
+            i->hops = hops;
+            i->expire = std::max(i->expire, lifetime + Simulator::Now());
+            return true;
+        }
+    }
+    if (m_alternatePaths.size() + 1 >= maxPaths)
+    {
+        return false;
+    }
+    AlternatePath path;
+    path.nextHop = nextHop;
+    path.dev = dev;
+    path.iface = iface;
+    path.hops = hops;
+    path.seqNo = m_seqNo;
+    path.expire = lifetime + Simulator::Now();
+    m_alternatePaths.push_back(path);
+    return true;
+}
+
+Ptr<Ipv4Route>
+RoutingTableEntry::GetRoute(uint32_t flowHash) const
+{
+    std::vector<const AlternatePath*> paths;
+    paths.reserve(m_alternatePaths.size());
+    for (std::vector<AlternatePath>::const_iterator i = m_alternatePaths.begin();
+         i != m_alternatePaths.end();
+         ++i)
+    {
+        if (i->seqNo == m_seqNo && i->expire >= Simulator::Now())
+        {
+            paths.push_back(&*i);
+        }
+    }
+    // The route is path 0, the others follow in insertion order so that a flow keeps its path
+    // as long as the set of paths does not change
+    uint32_t n = flowHash % (paths.size() + 1);
+    if (n == 0)
+    {
+        return m_ipv4Route;
+    }
+    const AlternatePath* path = paths[n - 1];
+    Ptr<Ipv4Route> route = Create<Ipv4Route>();
+    route->SetDestination(m_ipv4Route->GetDestination());
+    route->SetSource(path->iface.GetLocal());
+    route->SetGateway(path->nextHop);
+    route->SetOutputDevice(path->dev);
+    return route;
+}
+
+bool
+RoutingTableEntry::DeleteAlternatePath(Ipv4Address nextHop)
+{
+    NS_LOG_FUNCTION(this << nextHop);
+    std::vector<AlternatePath>::iterator i =
+        std::find_if(m_alternatePaths.begin(),
+                     m_alternatePaths.end(),
+                     [nextHop](const AlternatePath& p) { return p.nextHop == nextHop; });
+    if (i == m_alternatePaths.end())
+    {
+        return false;
+    }
+    m_alternatePaths.erase(i);
+    return true;
+}
+
+bool
+RoutingTableEntry::FailOver()
+{
+    NS_LOG_FUNCTION(this);
+    std::vector<AlternatePath>::iterator best = m_alternatePaths.end();
+    for (std::vector<AlternatePath>::iterator i = m_alternatePaths.begin();
+         i != m_alternatePaths.end();
+         ++i)
+    {
+        if (i->seqNo == m_seqNo && i->expire >= Simulator::Now() &&
+            (best == m_alternatePaths.end() || i->hops < best->hops))
+        {
+            best = i;
+        }
+    }
+    if (best == m_alternatePaths.end())
+    {
+        m_alternatePaths.clear();
+        return false;
+    }
+    NS_LOG_LOGIC("Fail over to " << best->nextHop << " for " << GetDestination());
+    SetNextHop(best->nextHop);
+    SetOutputDevice(best->dev);
+    SetInterface(best->iface);
+    SetHop(best->hops);
+    m_lifeTime = std::max(m_lifeTime, best->expire);
+    m_alternatePaths.erase(best);
+    return true;
+}
+
 void
 RoutingTableEntry::Invalidate(Time badLinkLifetime)
 {
@@ -177,6 +321,7 @@ RoutingTableEntry::Invalidate(Time badLinkLifetime)
     }
     m_flag = INVALID;
     m_reqCount = 0;
+    m_alternatePaths.clear();
     m_lifeTime = badLinkLifetime + Simulator::Now();
 }
 
@@ -229,7 +374,8 @@ RoutingTableEntry::Print(Ptr<OutputStreamWrapper> stream, Time::Unit unit /* = T
  */
 
 RoutingTable::RoutingTable(Time t)
-    : m_badLinkLifetime(t)
+    : m_badLinkLifetime(t),
+      m_hasPrefixRoutes(false)
 {
 }
 
@@ -268,14 +414,51 @@ RoutingTable::LookupValidRoute(Ipv4Address id, RoutingTableEntry& rt)
     return (rt.GetFlag() == VALID);
 }
 
+bool
+RoutingTable::LookupLongestPrefixRoute(Ipv4Address id, RoutingTableEntry& rt)
+{
+    NS_LOG_FUNCTION(this << id);
+    Purge();
+    std::map<Ipv4Address, RoutingTableEntry>::const_iterator i = m_ipv4AddressEntry.find(id);
+    if (i != m_ipv4AddressEntry.end() && i->second.GetFlag() == VALID &&
+        i->second.GetPrefixSize() == 0)
+    {
+        rt = i->second;
+        return true;
+    }
+    if (!m_hasPrefixRoutes)
+    {
+        return false;
+    }
+    // Subnet routes are keyed by their subnet address, try the longest prefixes first
+    for (uint8_t prefixSize = 31; prefixSize > 0; --prefixSize)
+    {
+        Ipv4Mask mask(0xffffffff << (32 - prefixSize));
+        i = m_ipv4AddressEntry.find(id.CombineMask(mask));
+        if (i != m_ipv4AddressEntry.end() && i->second.GetFlag() == VALID &&
+            i->second.GetPrefixSize() == prefixSize)
+        {
+            NS_LOG_LOGIC("Route to " << id << " found in subnet " << i->first << "/"
+                                     << (uint16_t)prefixSize);
+            rt = i->second;
+            return true;
+        }
+    }
+    return false;
+}
+
 bool
 RoutingTable::DeleteRoute(Ipv4Address dst)
 {
     NS_LOG_FUNCTION(this << dst);
     Purge();
-    if (m_ipv4AddressEntry.erase(dst) != 0)
+    std::map<Ipv4Address, RoutingTableEntry>::iterator i = m_ipv4AddressEntry.find(dst);
+    if (i != m_ipv4AddressEntry.end())
     {
+        bool wasValid = (i->second.GetFlag() == VALID);
+        m_ipv4AddressEntry.erase(i);
         NS_LOG_LOGIC("Route deletion to " << dst << " successful");
+        NotifyRouteState(dst, wasValid, false);
         return true;
     }
     NS_LOG_LOGIC("Route deletion to " << dst << " not successful");
@@ -291,8 +474,13 @@ RoutingTable::AddRoute(RoutingTableEntry& rt)
     {
         rt.SetRreqCnt(0);
     }
+    m_hasPrefixRoutes = m_hasPrefixRoutes || rt.GetPrefixSize() != 0;
     std::pair<std::map<Ipv4Address, RoutingTableEntry>::iterator, bool> result =
         m_ipv4AddressEntry.insert(std::make_pair(rt.GetDestination(), rt));
+    if (result.second)
+    {
+        NotifyRouteState(rt.GetDestination(), false, rt.GetFlag() == VALID);
+    }
     return result.second;
 }
 
@@ -307,12 +495,15 @@ RoutingTable::Update(RoutingTableEntry& rt)
         NS_LOG_LOGIC("Route update to " << rt.GetDestination() << " fails; not found");
         return false;
     }
+    bool wasValid = (i->second.GetFlag() == VALID);
+    m_hasPrefixRoutes = m_hasPrefixRoutes || rt.GetPrefixSize() != 0;
     i->second = rt;
     if (i->second.GetFlag() != IN_SEARCH)
     {
         NS_LOG_LOGIC("Route update to " << rt.GetDestination() << " set RreqCnt to 0");
         i->second.SetRreqCnt(0);
     }
+    NotifyRouteState(rt.GetDestination(), wasValid, rt.GetFlag() == VALID);
     return true;
 }
 
@@ -326,9 +517,11 @@ RoutingTable::SetEntryState(Ipv4Address id, RouteFlags state)
         NS_LOG_LOGIC("Route set entry state to " << id << " fails; not found");
         return false;
     }
+    bool wasValid = (i->second.GetFlag() == VALID);
     i->second.SetFlag(state);
     i->second.SetRreqCnt(0);
     NS_LOG_LOGIC("Route set entry state to " << id << ": new state is " << state);
+    NotifyRouteState(id, wasValid, state == VALID);
     return true;
 }
 
@@ -351,6 +544,38 @@ RoutingTable::GetListOfDestinationWithNextHop(Ipv4Address nextHop,
     }
 }
 
+void
+RoutingTable::GetInSearchDestinations(Ipv4Address subnet,
+                                      Ipv4Mask mask,
+                                      std::vector<Ipv4Address>& searched)
+{
+    NS_LOG_FUNCTION(this << subnet << mask);
+    Purge();
+    searched.clear();
+    for (std::map<Ipv4Address, RoutingTableEntry>::const_iterator i = m_ipv4AddressEntry.begin();
+         i != m_ipv4AddressEntry.end();
+         ++i)
+    {
+        if (i->second.GetFlag() == IN_SEARCH && i->second.GetPrefixSize() == 0 &&
+            mask.IsMatch(i->first, subnet))
+        {
+            searched.push_back(i->first);
+        }
+    }
+}
+
+void
+RoutingTable::DeleteAlternatePaths(Ipv4Address nextHop)
+{
+    NS_LOG_FUNCTION(this << nextHop);
+    for (std::map<Ipv4Address, RoutingTableEntry>::iterator i = m_ipv4AddressEntry.begin();
+         i != m_ipv4AddressEntry.end();
+         ++i)
+    {
+        i->second.DeleteAlternatePath(nextHop);
+    }
+}
+
 void
 RoutingTable::InvalidateRoutesWithDst(const std::map<Ipv4Address, uint32_t>& unreachable)
 {
@@ -368,6 +593,7 @@ RoutingTable::InvalidateRoutesWithDst(const std::map<Ipv4Address, uint32_t>& unr
             {
                 NS_LOG_LOGIC("Invalidate route with destination address " << i->first);
                 i->second.Invalidate(m_badLinkLifetime);
+                NotifyRouteState(i->first, true, false);
             }
         }
     }
@@ -388,7 +614,10 @@ RoutingTable::DeleteAllRoutesFromInterface(Ipv4InterfaceAddress iface)
         {
             std::map<Ipv4Address, RoutingTableEntry>::iterator tmp = i;
             ++i;
+            bool wasValid = (tmp->second.GetFlag() == VALID);
+            Ipv4Address dst = tmp->first;
             m_ipv4AddressEntry.erase(tmp);
+            NotifyRouteState(dst, wasValid, false);
         }
         else
         {
@@ -420,6 +649,7 @@ RoutingTable::Purge()
             {
                 NS_LOG_LOGIC("Invalidate route with destination address " << i->first);
                 i->second.Invalidate(m_badLinkLifetime);
+                NotifyRouteState(i->first, true, false);
                 ++i;
             }
             else
@@ -470,6 +700,15 @@ RoutingTable::Purge(std::map<Ipv4Address, RoutingTableEntry>& table) const
     }
 }
 
+void
+RoutingTable::NotifyRouteState(Ipv4Address dst, bool wasValid, bool isValid) const
+{
+    if (wasValid != isValid && !m_routeStateCallback.IsNull())
+    {
+        m_routeStateCallback(dst, isValid);
+    }
+}
+
 bool
 RoutingTable::MarkLinkAsUnidirectional(Ipv4Address neighbor, Time blacklistTimeout)
 {
@@ -118,6 +118,64 @@ class RoutingTableEntry
     void GetPrecursors(std::vector<Ipv4Address>& prec) const;
     //\}
 
+    /// Alternate path to the destination, kept as a backup of the route
+    struct AlternatePath
+    {
+        Ipv4Address nextHop;        ///< Next hop of the path
+        Ptr<NetDevice> dev;         ///< Output device
+        Ipv4InterfaceAddress iface; ///< Output interface address
+        uint16_t hops;              ///< Hop count of the path
+        uint32_t seqNo;             ///< Destination sequence number the path was learned with
+        Time expire;                ///< Expiration time of the path
+    };
+
+    ///\name Alternate paths management
+    //\{
+    /**
+     * Insert or refresh an alternate path. A path is only accepted if its next hop differs from
+     * the one of the route, it was learned with the current destination sequence number and its
+     * hop count does not exceed the current one of the route. Unlike AOMDV, there is no advertised
+     * hop count fixed per sequence number, so the paths are not guaranteed to be loop free.
+     * \param nextHop next hop of the path
+     * \param dev output device
+     * \param iface output interface address
+     * \param hops hop count of the path
+     * \param lifetime lifetime of the path
+     * \param maxPaths maximum number of paths, the route included
+     * \return true if the path was inserted or refreshed
+     */
+    bool InsertAlternatePath(Ipv4Address nextHop,
+                             Ptr<NetDevice> dev,
+                             Ipv4InterfaceAddress iface,
+                             uint16_t hops,
+                             Time lifetime,
+                             uint32_t maxPaths);
+    /**
+     * Delete the alternate path through a next hop
+     * \param nextHop next hop of the path
+     * \return true if such a path existed
+     */
+    bool DeleteAlternatePath(Ipv4Address nextHop);
+    /**
+     * Replace the next hop of the route with the shortest usable alternate path
+     * \return true if an alternate path was found
+     */
+    bool FailOver();
+    /**
+     * \returns the alternate paths
+     */
+    const std::vector<AlternatePath>& GetAlternatePaths() const
+    {
+        return m_alternatePaths;
+    }
+    /**
+     * Pick one of the usable paths, the route included, for a flow
+     * \param flowHash hash of the flow
+     * \returns the route through the selected path
+     */
+    Ptr<Ipv4Route> GetRoute(uint32_t flowHash) const;
+    //\}
+
     /**
      * Mark entry as "down" (i.e. disable it)
      * \param badLinkLifetime duration to keep entry marked as invalid
@@ -260,6 +318,28 @@ class RoutingTableEntry
         return m_hops;
     }
 
+    /**
+     * Make the entry a route to the whole subnet of its destination. The destination is reduced
+     * to the subnet address.
+     * \param prefixSize the length of the subnet prefix, 0 for a host route
+     */
+    void SetPrefixSize(uint8_t prefixSize);
+
+    /**
+     * Get the length of the subnet prefix
+     * \returns the length of the subnet prefix, 0 for a host route
+     */
+    uint8_t GetPrefixSize() const
+    {
+        return m_prefixSize;
+    }
+
+    /**
+     * Get the mask of the destinations the entry is a route to
+     * \returns the subnet mask, all ones for a host route
+     */
+    Ipv4Mask GetPrefixMask() const;
+
     /**
      * Set the lifetime
      * \param lt The lifetime
@@ -385,6 +465,8 @@ class RoutingTableEntry
     uint32_t m_seqNo;
     /// Hop Count (number of hops needed to reach destination)
     uint16_t m_hops;
+    /// Length of the subnet prefix the route is valid for, 0 for a host route
+    uint8_t m_prefixSize;
     /**
      * \brief Expiration or deletion time of the route
      * Lifetime field in the routing table plays dual role:
@@ -406,6 +488,8 @@ class RoutingTableEntry
 
     /// List of precursors
     std::vector<Ipv4Address> m_precursorList;
+    /// Alternate paths to the destination
+    std::vector<AlternatePath> m_alternatePaths;
     /// When I can send another request
     Time m_routeRequestTimout;
     /// Number of route requests
@@ -452,6 +536,16 @@ class RoutingTable
     }
 
     //\}
+
+    /**
+     * Set the callback invoked when the route to a destination becomes valid or stops being valid
+     * \param cb the callback, its arguments are the destination and whether the route is valid
+     */
+    void SetRouteStateCallback(Callback<void, Ipv4Address, bool> cb)
+    {
+        m_routeStateCallback = cb;
+    }
+
     /**
      * Add routing table entry if it doesn't yet exist in routing table
      * \param r routing table entry
@@ -478,6 +572,15 @@ class RoutingTable
      * \return true on success
      */
     bool LookupValidRoute(Ipv4Address dst, RoutingTableEntry& rt);
+    /**
+     * Lookup the valid route with the longest prefix matching a destination, a host route being
+     * the longest. Subnet routes are keyed by their subnet address, so the table holds one prefix
+     * size per subnet address.
+     * \param dst destination address
+     * \param rt the host or subnet route to dst, if exists
+     * \return true on success
+     */
+    bool LookupLongestPrefixRoute(Ipv4Address dst, RoutingTableEntry& rt);
     /**
      * Update routing table
      * \param rt entry with destination address dst, if exists
@@ -499,6 +602,20 @@ class RoutingTable
      */
     void GetListOfDestinationWithNextHop(Ipv4Address nextHop,
                                          std::map<Ipv4Address, uint32_t>& unreachable);
+    /**
+     * Lookup the host routes being searched for in a subnet
+     * \param subnet the subnet address
+     * \param mask the subnet mask
+     * \param searched the destinations of the IN_SEARCH host routes of the subnet
+     */
+    void GetInSearchDestinations(Ipv4Address subnet,
+                                 Ipv4Mask mask,
+                                 std::vector<Ipv4Address>& searched);
+    /**
+     * Delete the alternate paths through a next hop from all entries
+     * \param nextHop the next hop
+     */
+    void DeleteAlternatePaths(Ipv4Address nextHop);
     /**
      * Update routing entries with this destination as follows:
      * 1. The destination sequence number of this routing entry, if it
@@ -541,6 +658,17 @@ class RoutingTable
     std::map<Ipv4Address, RoutingTableEntry> m_ipv4AddressEntry;
     /// Deletion time for invalid routes
     Time m_badLinkLifetime;
+    /// Indicates whether a subnet route was ever added, host lookups skip the prefix search before
+    bool m_hasPrefixRoutes;
+    /// Route state change callback
+    Callback<void, Ipv4Address, bool> m_routeStateCallback;
+    /**
+     * Invoke the route state change callback if the validity of a route changed
+     * \param dst the destination address
+     * \param wasValid whether the route was valid before the change
+     * \param isValid whether the route is valid after the change
+     */
+    void NotifyRouteState(Ipv4Address dst, bool wasValid, bool isValid) const;
     /**
      * const version of Purge, for use by Print() method
      * \param table the routing table entry to purge
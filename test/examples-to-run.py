@@ -9,6 +9,7 @@
 # See test.py for more information.
 cpp_examples = [
     ("madaodv", "True", "True"),
+    ("madaodv-benchmark --time=10 --suppression=Counter", "True", "False"),
 ]
 
 # A list of Python examples to run in order to ensure that they remain
@@ -0,0 +1,1695 @@
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/boolean.h"
+#include "ns3/double.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-interface-container.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/madaodv-helper.h"
+#include "ns3/madaodv-packet.h"
+#include "ns3/madaodv-routing-protocol.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/mobility-model.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/simulator.h"
+#include "ns3/socket-factory.h"
+#include "ns3/string.h"
+#include "ns3/test.h"
+#include "ns3/udp-header.h"
+#include "ns3/udp-l4-protocol.h"
+#include "ns3/udp-socket-factory.h"
+#include "ns3/uinteger.h"
+#include "ns3/yans-wifi-helper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <set>
+#include <string>
+
+namespace ns3
+{
+namespace madaodv
+{
+
+/**
+ * \ingroup madaodv-test
+ *
+ * Install 802.11a ad hoc WiFi, the internet stack and MADAODV on nodes at fixed positions. At
+ * 6 Mbps, nodes 120 m apart hear each other and nodes 220 m apart do not.
+ * \param nodes the nodes
+ * \param positions the node positions, in node order
+ * \param madaodv the MADAODV helper holding the attributes under test
+ * \returns the interfaces, addressed in 10.1.1.0/24 in node order
+ */
+static Ipv4InterfaceContainer
+InstallNodes(NodeContainer& nodes, Ptr<PositionAllocator> positions, MadaodvHelper& madaodv)
+{
+    MobilityHelper mobility;
+    mobility.SetPositionAllocator(positions);
+    mobility.SetMobilityModel("ns3::ConstantPositionMobilityModel");
+    mobility.Install(nodes);
+
+    WifiMacHelper wifiMac;
+    wifiMac.SetType("ns3::AdhocWifiMac");
+    YansWifiPhyHelper wifiPhy;
+    wifiPhy.SetErrorRateModel("ns3::YansErrorRateModel");
+    YansWifiChannelHelper wifiChannel = YansWifiChannelHelper::Default();
+    wifiPhy.SetChannel(wifiChannel.Create());
+    WifiHelper wifi;
+    wifi.SetStandard(WIFI_STANDARD_80211a);
+    wifi.SetRemoteStationManager("ns3::ConstantRateWifiManager",
+                                 "DataMode",
+                                 StringValue("OfdmRate6Mbps"),
+                                 "RtsCtsThreshold",
+                                 StringValue("2200"));
+    NetDeviceContainer devices = wifi.Install(wifiPhy, wifiMac, nodes);
+
+    InternetStackHelper internetStack;
+    internetStack.SetRoutingHelper(madaodv);
+    internetStack.Install(nodes);
+    Ipv4AddressHelper address;
+    address.SetBase("10.1.1.0", "255.255.255.0");
+    return address.Assign(devices);
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * Install the nodes on a row, see InstallNodes
+ * \param nodes the nodes
+ * \param spacing distance between two consecutive nodes in meters
+ * \param madaodv the MADAODV helper holding the attributes under test
+ * \returns the interfaces, addressed in 10.1.1.0/24 in node order
+ */
+static Ipv4InterfaceContainer
+InstallRow(NodeContainer& nodes, double spacing, MadaodvHelper& madaodv)
+{
+    Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator>();
+    for (uint32_t i = 0; i < nodes.GetN(); ++i)
+    {
+        positions->Add(Vector(i * spacing, 0, 0));
+    }
+    return InstallNodes(nodes, positions, madaodv);
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Constant bit rate UDP flow between two nodes which records when packets arrive
+ */
+class UdpFlow
+{
+  public:
+    /**
+     * Create the sockets of the flow and schedule its packets
+     * \param source the source node
+     * \param destination the destination node
+     * \param address the destination address
+     * \param start time of the first packet
+     * \param stop time after which no packet is sent
+     * \param interval time between two packets
+     */
+    void Install(Ptr<Node> source,
+                 Ptr<Node> destination,
+                 Ipv4Address address,
+                 Time start,
+                 Time stop,
+                 Time interval)
+    {
+        m_address = address;
+        m_stop = stop;
+        m_interval = interval;
+        m_rx = Socket::CreateSocket(destination, TypeId::LookupByName("ns3::UdpSocketFactory"));
+        m_rx->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+        m_rx->SetRecvCallback(MakeCallback(&UdpFlow::Receive, this));
+        m_tx = Socket::CreateSocket(source, TypeId::LookupByName("ns3::UdpSocketFactory"));
+        Simulator::ScheduleWithContext(source->GetId(), start, &UdpFlow::Send, this);
+    }
+
+    /// Close the sockets, before the simulator is destroyed
+    void Close()
+    {
+        m_tx->Close();
+        m_rx->Close();
+    }
+
+    /**
+     * Count the packets received in a time window
+     * \param from start of the window
+     * \param to end of the window
+     * \returns the number of packets received in [from, to)
+     */
+    uint32_t GetReceived(Time from, Time to) const
+    {
+        return std::count_if(m_received.begin(), m_received.end(), [from, to](Time t) {
+            return t >= from && t < to;
+        });
+    }
+
+  private:
+    /// Send one packet and schedule the next one
+    void Send()
+    {
+        if (Simulator::Now() > m_stop)
+        {
+            return;
+        }
+        m_tx->SendTo(Create<Packet>(100), 0, InetSocketAddress(m_address, m_port));
+        Simulator::Schedule(m_interval, &UdpFlow::Send, this);
+    }
+
+    /**
+     * Receive packet function
+     * \param socket The socket to receive data
+     */
+    void Receive(Ptr<Socket> socket)
+    {
+        Ptr<Packet> packet;
+        while ((packet = socket->Recv(std::numeric_limits<uint32_t>::max(), 0)))
+        {
+            m_received.push_back(Simulator::Now());
+        }
+    }
+
+    Ipv4Address m_address;        //!< destination address
+    uint16_t m_port{9};           //!< destination port
+    Time m_stop;                  //!< time after which no packet is sent
+    Time m_interval;              //!< time between two packets
+    Ptr<Socket> m_tx;             //!< transmit socket
+    Ptr<Socket> m_rx;             //!< receive socket
+    std::vector<Time> m_received; //!< arrival times of the packets
+};
+
+/**
+ * \ingroup madaodv-test
+ *
+ * Check whether a packet still carries a packet tag of MADAODV
+ * \param p the packet
+ * \returns true if a MADAODV packet tag is attached to the packet
+ */
+static bool
+HasMadaodvTag(Ptr<const Packet> p)
+{
+    PacketTagIterator i = p->GetPacketTagIterator();
+    while (i.HasNext())
+    {
+        if (i.Next().GetTypeId().GetName().rfind("ns3::madaodv::", 0) == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * Read the MADAODV message of a packet seen by the IPv4 transmit trace
+ * \param p the packet, with its IP header
+ * \param type the message type looked for
+ * \param message the message header, read if the packet carries such a message
+ * \returns true if the packet carries a MADAODV message of that type
+ */
+static bool
+PeekMessage(Ptr<const Packet> p, MessageType type, Header& message)
+{
+    Ptr<Packet> copy = p->Copy();
+    Ipv4Header ipHeader;
+    copy->RemoveHeader(ipHeader);
+    if (ipHeader.GetProtocol() != UdpL4Protocol::PROT_NUMBER)
+    {
+        return false;
+    }
+    UdpHeader udpHeader;
+    copy->RemoveHeader(udpHeader);
+    if (udpHeader.GetDestinationPort() != RoutingProtocol::MADAODV_PORT)
+    {
+        return false;
+    }
+    TypeHeader typeHeader;
+    copy->RemoveHeader(typeHeader);
+    if (!typeHeader.IsValid() || typeHeader.Get() != type)
+    {
+        return false;
+    }
+    copy->RemoveHeader(message);
+    return true;
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Data packets reach their destinations unchanged
+ *
+ * A chain of nodes where each node hears only its neighbors. The first node either sends subnet
+ * directed broadcasts, which every other node delivers locally and forwards, or sends a burst of
+ * unicast packets to the last node, which wait in the queue for the route. Every packet must be
+ * delivered once, as the packet which was sent and without any MADAODV tag.
+ */
+class DataDeliveryTestCase : public TestCase
+{
+    bool m_broadcast;              //!< whether broadcast or unicast packets are sent
+    uint32_t m_size;               //!< number of nodes in the chain
+    uint32_t m_packets;            //!< number of packets sent
+    uint32_t m_received;           //!< number of packets received by all nodes
+    uint32_t m_unknown;            //!< number of received packets which were not sent as such
+    uint32_t m_tagged;             //!< number of received packets with a MADAODV tag
+    std::set<uint64_t> m_sent;     //!< UIDs of the sent packets
+    uint16_t m_port;               //!< receive port
+    Ipv4Address m_destination;     //!< destination address
+    Ptr<Socket> m_txSocket;        //!< transmit socket
+    std::vector<Ptr<Socket>> m_rx; //!< receive sockets
+
+    /**
+     * Send one data packet
+     * \param socket The socket to send data
+     * \param remaining number of packets left to send
+     */
+    void SendData(Ptr<Socket> socket, uint32_t remaining);
+    /**
+     * Receive packet function
+     * \param socket The socket to receive data
+     */
+    void ReceivePkt(Ptr<Socket> socket);
+
+  public:
+    /**
+     * Constructor
+     * \param broadcast whether broadcast or unicast packets are sent
+     */
+    DataDeliveryTestCase(bool broadcast);
+    void DoRun() override;
+};
+
+DataDeliveryTestCase::DataDeliveryTestCase(bool broadcast)
+    : TestCase(broadcast ? "Forwarded broadcast packets are delivered unchanged"
+                         : "Queued unicast packets are delivered unchanged"),
+      m_broadcast(broadcast),
+      m_size(4),
+      m_packets(5),
+      m_received(0),
+      m_unknown(0),
+      m_tagged(0),
+      m_port(9)
+{
+}
+
+void
+DataDeliveryTestCase::SendData(Ptr<Socket> socket, uint32_t remaining)
+{
+    if (remaining == 0)
+    {
+        return;
+    }
+    Ptr<Packet> packet = Create<Packet>(500);
+    m_sent.insert(packet->GetUid());
+    socket->SendTo(packet, 0, InetSocketAddress(m_destination, m_port));
+    // Broadcasts are spread out, unicast packets are sent at once to wait for the route together
+    Simulator::ScheduleWithContext(socket->GetNode()->GetId(),
+                                   m_broadcast ? Seconds(1.0) : Seconds(0),
+                                   &DataDeliveryTestCase::SendData,
+                                   this,
+                                   socket,
+                                   remaining - 1);
+}
+
+void
+DataDeliveryTestCase::ReceivePkt(Ptr<Socket> socket)
+{
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv(std::numeric_limits<uint32_t>::max(), 0)))
+    {
+        m_received++;
+        if (m_sent.find(packet->GetUid()) == m_sent.end())
+        {
+            m_unknown++;
+        }
+        if (HasMadaodvTag(packet))
+        {
+            m_tagged++;
+        }
+    }
+}
+
+void
+DataDeliveryTestCase::DoRun()
+{
+    RngSeedManager::SetSeed(12345);
+    RngSeedManager::SetRun(7);
+
+    NodeContainer nodes;
+    nodes.Create(m_size);
+    // No hellos to keep the channel quiet
+    MadaodvHelper madaodv;
+    madaodv.Set("EnableHello", BooleanValue(false));
+    Ipv4InterfaceContainer interfaces = InstallRow(nodes, 120, madaodv);
+    m_destination =
+        m_broadcast ? Ipv4Address("10.1.1.255") : interfaces.GetAddress(m_size - 1);
+
+    for (uint32_t i = 1; i < m_size; ++i)
+    {
+        if (!m_broadcast && i != m_size - 1)
+        {
+            continue;
+        }
+        Ptr<Socket> rx =
+            Socket::CreateSocket(nodes.Get(i), TypeId::LookupByName("ns3::UdpSocketFactory"));
+        rx->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+        rx->SetRecvCallback(MakeCallback(&DataDeliveryTestCase::ReceivePkt, this));
+        m_rx.push_back(rx);
+    }
+
+    m_txSocket = Socket::CreateSocket(nodes.Get(0), TypeId::LookupByName("ns3::UdpSocketFactory"));
+    m_txSocket->SetAllowBroadcast(true);
+    Simulator::ScheduleWithContext(m_txSocket->GetNode()->GetId(),
+                                   Seconds(1.0),
+                                   &DataDeliveryTestCase::SendData,
+                                   this,
+                                   m_txSocket,
+                                   m_packets);
+
+    Simulator::Stop(Seconds(m_packets + 2));
+    Simulator::Run();
+
+    uint32_t receivers = m_rx.size();
+    m_txSocket->Close();
+    for (std::vector<Ptr<Socket>>::iterator i = m_rx.begin(); i != m_rx.end(); ++i)
+    {
+        (*i)->Close();
+    }
+    m_rx.clear();
+
+    Simulator::Destroy();
+
+    NS_TEST_ASSERT_MSG_EQ(m_received,
+                          m_packets * receivers,
+                          "Every receiver must receive every packet once.");
+    NS_TEST_ASSERT_MSG_EQ(m_unknown, 0, "Received packets must be the packets which were sent.");
+    NS_TEST_ASSERT_MSG_EQ(m_tagged, 0, "Received packets must not carry MADAODV tags.");
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief RouteInput hands data packets on without copying them
+ *
+ * A chain of three nodes where the first node discovers a route to the last one. The middle node
+ * is then given a subnet directed broadcast, a unicast packet for itself and a unicast packet to
+ * forward. Every packet must reach the local delivery and forward callbacks as the very packet
+ * given to RouteInput; a copy taken on the way shows up as another packet object.
+ */
+class RouteInputCopyTestCase : public TestCase
+{
+    Ptr<const Packet> m_input; //!< packet given to RouteInput
+    uint32_t m_passed;         //!< number of callbacks given the input packet itself
+    uint32_t m_copied;         //!< number of callbacks given another packet
+    uint32_t m_errors;         //!< number of error callbacks
+
+    /**
+     * Give a UDP data packet from the first node to RouteInput of the middle node
+     * \param routing the routing protocol of the middle node
+     * \param idev the input device of the middle node
+     * \param source address of the first node
+     * \param destination destination of the packet
+     */
+    void Input(Ptr<RoutingProtocol> routing,
+               Ptr<NetDevice> idev,
+               Ipv4Address source,
+               Ipv4Address destination);
+    /**
+     * Count whether a callback was given the input packet itself
+     * \param p the packet given to the callback
+     */
+    void Check(Ptr<const Packet> p);
+    /**
+     * Unicast forward callback
+     * \param route the route
+     * \param p the packet
+     * \param header the IP header
+     */
+    void Forward(Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header& header);
+    /**
+     * Local delivery callback
+     * \param p the packet
+     * \param header the IP header
+     * \param interface the input interface
+     */
+    void Deliver(Ptr<const Packet> p, const Ipv4Header& header, uint32_t interface);
+    /**
+     * Error callback
+     * \param p the packet
+     * \param header the IP header
+     * \param err the error
+     */
+    void Error(Ptr<const Packet> p, const Ipv4Header& header, Socket::SocketErrno err);
+
+  public:
+    RouteInputCopyTestCase();
+    void DoRun() override;
+};
+
+RouteInputCopyTestCase::RouteInputCopyTestCase()
+    : TestCase("RouteInput delivers and forwards data packets without copies"),
+      m_passed(0),
+      m_copied(0),
+      m_errors(0)
+{
+}
+
+void
+RouteInputCopyTestCase::Input(Ptr<RoutingProtocol> routing,
+                              Ptr<NetDevice> idev,
+                              Ipv4Address source,
+                              Ipv4Address destination)
+{
+    Ptr<Packet> packet = Create<Packet>(500);
+    UdpHeader udpHeader;
+    udpHeader.SetSourcePort(9);
+    udpHeader.SetDestinationPort(9);
+    packet->AddHeader(udpHeader);
+    Ipv4Header header;
+    header.SetSource(source);
+    header.SetDestination(destination);
+    header.SetProtocol(UdpL4Protocol::PROT_NUMBER);
+    header.SetPayloadSize(packet->GetSize());
+    header.SetTtl(64);
+    m_input = packet;
+    routing->RouteInput(packet,
+                        header,
+                        idev,
+                        MakeCallback(&RouteInputCopyTestCase::Forward, this),
+                        Ipv4RoutingProtocol::MulticastForwardCallback(),
+                        MakeCallback(&RouteInputCopyTestCase::Deliver, this),
+                        MakeCallback(&RouteInputCopyTestCase::Error, this));
+}
+
+void
+RouteInputCopyTestCase::Check(Ptr<const Packet> p)
+{
+    if (PeekPointer(p) == PeekPointer(m_input))
+    {
+        m_passed++;
+    }
+    else
+    {
+        m_copied++;
+    }
+}
+
+void
+RouteInputCopyTestCase::Forward(Ptr<Ipv4Route> route, Ptr<const Packet> p, const Ipv4Header& header)
+{
+    Check(p);
+}
+
+void
+RouteInputCopyTestCase::Deliver(Ptr<const Packet> p, const Ipv4Header& header, uint32_t interface)
+{
+    Check(p);
+}
+
+void
+RouteInputCopyTestCase::Error(Ptr<const Packet> p,
+                              const Ipv4Header& header,
+                              Socket::SocketErrno err)
+{
+    m_errors++;
+}
+
+void
+RouteInputCopyTestCase::DoRun()
+{
+    RngSeedManager::SetSeed(12345);
+    RngSeedManager::SetRun(7);
+
+    NodeContainer nodes;
+    nodes.Create(3);
+    MadaodvHelper madaodv;
+    madaodv.Set("EnableHello", BooleanValue(false));
+    Ipv4InterfaceContainer interfaces = InstallRow(nodes, 120, madaodv);
+
+    // The middle node learns the routes to both ends from the discovery
+    Simulator::ScheduleWithContext(0,
+                                   Seconds(1),
+                                   &RoutingProtocol::RequestRoute,
+                                   nodes.Get(0)->GetObject<RoutingProtocol>(),
+                                   interfaces.GetAddress(2));
+    Ptr<RoutingProtocol> routing = nodes.Get(1)->GetObject<RoutingProtocol>();
+    Ptr<NetDevice> idev = interfaces.Get(1).first->GetNetDevice(interfaces.Get(1).second);
+    // Broadcast delivered locally and forwarded, unicast delivered locally, unicast forwarded
+    Ipv4Address destinations[] = {Ipv4Address("10.1.1.255"),
+                                  interfaces.GetAddress(1),
+                                  interfaces.GetAddress(2)};
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        Simulator::ScheduleWithContext(1,
+                                       Seconds(2 + i * 0.1),
+                                       &RouteInputCopyTestCase::Input,
+                                       this,
+                                       routing,
+                                       idev,
+                                       interfaces.GetAddress(0),
+                                       destinations[i]);
+    }
+
+    Simulator::Stop(Seconds(3));
+    Simulator::Run();
+    m_input = nullptr;
+    Simulator::Destroy();
+
+    NS_TEST_ASSERT_MSG_EQ(m_errors, 0, "Every packet must be delivered or forwarded.");
+    NS_TEST_ASSERT_MSG_EQ(m_passed, 4, "Every callback must get the packet given to RouteInput.");
+    NS_TEST_ASSERT_MSG_EQ(m_copied, 0, "No data packet may be copied.");
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Two nodes in range stay neighbors for as long as they exchange hellos
+ *
+ * Every hello must be a distinct packet, otherwise the receiver drops the repeats as duplicate
+ * broadcasts and the neighbor expires after AllowedHelloLoss hello intervals.
+ */
+class HelloNeighborTestCase : public TestCase
+{
+    Ipv4Address m_neighbor; //!< address of the neighbor of the first node
+    uint32_t m_valid;       //!< number of times the route to the neighbor became valid
+    uint32_t m_invalid;     //!< number of times the route to the neighbor became invalid
+
+    /**
+     * Route state trace sink
+     * \param dst the destination
+     * \param valid whether the route to dst became valid
+     */
+    void RouteState(Ipv4Address dst, bool valid);
+
+  public:
+    HelloNeighborTestCase();
+    void DoRun() override;
+};
+
+HelloNeighborTestCase::HelloNeighborTestCase()
+    : TestCase("Neighbors exchanging hellos do not expire"),
+      m_valid(0),
+      m_invalid(0)
+{
+}
+
+void
+HelloNeighborTestCase::RouteState(Ipv4Address dst, bool valid)
+{
+    if (dst != m_neighbor)
+    {
+        return;
+    }
+    if (valid)
+    {
+        m_valid++;
+    }
+    else
+    {
+        m_invalid++;
+    }
+}
+
+void
+HelloNeighborTestCase::DoRun()
+{
+    RngSeedManager::SetSeed(12345);
+    RngSeedManager::SetRun(7);
+
+    NodeContainer nodes;
+    nodes.Create(2);
+    MadaodvHelper madaodv;
+    madaodv.Set("EnableHello", BooleanValue(true));
+    Ipv4InterfaceContainer interfaces = InstallRow(nodes, 120, madaodv);
+    m_neighbor = interfaces.GetAddress(1);
+
+    Ptr<RoutingProtocol> routing = nodes.Get(0)->GetObject<RoutingProtocol>();
+    NS_TEST_ASSERT_MSG_NE(routing, nullptr, "MADAODV must be aggregated to the node");
+    routing->TraceConnectWithoutContext("RouteState",
+                                        MakeCallback(&HelloNeighborTestCase::RouteState, this));
+
+    // Many times AllowedHelloLoss * HelloInterval
+    Simulator::Stop(Seconds(20));
+    Simulator::Run();
+    Simulator::Destroy();
+
+    NS_TEST_ASSERT_MSG_GT(m_valid, 0, "The neighbor must be learned from its hellos.");
+    NS_TEST_ASSERT_MSG_EQ(m_invalid, 0, "The neighbor must not expire while it sends hellos.");
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief A flow keeps its path when striping over equal-cost paths
+ *
+ * The source reaches the destination over two relays, and learns both paths. It sends one UDP
+ * flow whose payloads all differ: every packet must take the same relay.
+ */
+class FlowPinningTestCase : public TestCase
+{
+    uint32_t m_packets;                          //!< number of data packets sent
+    uint32_t m_received;                         //!< number of data packets delivered
+    std::map<std::string, uint32_t> m_forwarded; //!< data packets forwarded by each relay
+    uint16_t m_port;                             //!< receive port
+    Ipv4Address m_destination;                   //!< destination address
+
+    /**
+     * Send one data packet, with a payload different from all the others
+     * \param socket The socket to send data
+     * \param remaining number of packets left to send
+     */
+    void SendData(Ptr<Socket> socket, uint32_t remaining);
+    /**
+     * Receive packet function
+     * \param socket The socket to receive data
+     */
+    void ReceivePkt(Ptr<Socket> socket);
+    /**
+     * Unicast forward trace sink
+     * \param relay the relay, as trace context
+     * \param header the IP header of the packet
+     * \param p the packet
+     * \param interface the input interface
+     */
+    void Forward(std::string relay,
+                 const Ipv4Header& header,
+                 Ptr<const Packet> p,
+                 uint32_t interface);
+
+  public:
+    FlowPinningTestCase();
+    void DoRun() override;
+};
+
+FlowPinningTestCase::FlowPinningTestCase()
+    : TestCase("Striping keeps the packets of a flow on one path"),
+      m_packets(10),
+      m_received(0),
+      m_port(9)
+{
+}
+
+void
+FlowPinningTestCase::SendData(Ptr<Socket> socket, uint32_t remaining)
+{
+    if (remaining == 0)
+    {
+        return;
+    }
+    uint8_t payload[64];
+    std::fill(payload, payload + sizeof(payload), static_cast<uint8_t>(remaining * 37));
+    socket->SendTo(Create<Packet>(payload, sizeof(payload) - remaining),
+                   0,
+                   InetSocketAddress(m_destination, m_port));
+    Simulator::ScheduleWithContext(socket->GetNode()->GetId(),
+                                   MilliSeconds(200),
+                                   &FlowPinningTestCase::SendData,
+                                   this,
+                                   socket,
+                                   remaining - 1);
+}
+
+void
+FlowPinningTestCase::ReceivePkt(Ptr<Socket> socket)
+{
+    Ptr<Packet> packet;
+    while ((packet = socket->Recv(std::numeric_limits<uint32_t>::max(), 0)))
+    {
+        m_received++;
+    }
+}
+
+void
+FlowPinningTestCase::Forward(std::string relay,
+                             const Ipv4Header& header,
+                             Ptr<const Packet> p,
+                             uint32_t interface)
+{
+    if (header.GetDestination() == m_destination)
+    {
+        m_forwarded[relay]++;
+    }
+}
+
+void
+FlowPinningTestCase::DoRun()
+{
+    RngSeedManager::SetSeed(12345);
+    RngSeedManager::SetRun(7);
+
+    // Source, two relays in range of each other, destination out of range of the source
+    NodeContainer nodes;
+    nodes.Create(4);
+    Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator>();
+    positions->Add(Vector(0, 0, 0));
+    positions->Add(Vector(115, 30, 0));
+    positions->Add(Vector(115, -30, 0));
+    positions->Add(Vector(230, 0, 0));
+    MadaodvHelper madaodv;
+    madaodv.Set("EnableHello", BooleanValue(false));
+    madaodv.Set("EnableMultipath", BooleanValue(true));
+    madaodv.Set("EnableStriping", BooleanValue(true));
+    Ipv4InterfaceContainer interfaces = InstallNodes(nodes, positions, madaodv);
+    m_destination = interfaces.GetAddress(3);
+
+    for (uint32_t i = 1; i <= 2; ++i)
+    {
+        nodes.Get(i)->GetObject<Ipv4L3Protocol>()->TraceConnect(
+            "UnicastForward",
+            std::to_string(i),
+            MakeCallback(&FlowPinningTestCase::Forward, this));
+    }
+    Ptr<Socket> rx =
+        Socket::CreateSocket(nodes.Get(3), TypeId::LookupByName("ns3::UdpSocketFactory"));
+    rx->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+    rx->SetRecvCallback(MakeCallback(&FlowPinningTestCase::ReceivePkt, this));
+    Ptr<Socket> tx =
+        Socket::CreateSocket(nodes.Get(0), TypeId::LookupByName("ns3::UdpSocketFactory"));
+
+    // Learn both paths before the flow starts
+    Ptr<RoutingProtocol> routing = nodes.Get(0)->GetObject<RoutingProtocol>();
+    Simulator::ScheduleWithContext(0,
+                                   Seconds(1),
+                                   &RoutingProtocol::RequestRoute,
+                                   routing,
+                                   m_destination);
+    Simulator::ScheduleWithContext(0,
+                                   Seconds(2),
+                                   &FlowPinningTestCase::SendData,
+                                   this,
+                                   tx,
+                                   m_packets);
+
+    Simulator::Stop(Seconds(5));
+    Simulator::Run();
+    tx->Close();
+    rx->Close();
+    Simulator::Destroy();
+
+    NS_TEST_ASSERT_MSG_EQ(m_received, m_packets, "Every packet must be delivered.");
+    NS_TEST_ASSERT_MSG_EQ(m_forwarded["1"] + m_forwarded["2"],
+                          m_packets,
+                          "Every packet must cross one relay.");
+    NS_TEST_ASSERT_MSG_EQ(std::min(m_forwarded["1"], m_forwarded["2"]),
+                          0,
+                          "All packets of the flow must take the same relay.");
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Packets of a failed route discovery are reported as dropped
+ *
+ * A lone node sends packets to an address nobody owns. Whether the packets wait for the route
+ * behind the loopback device or in direct deferral, each of them must be reported as a route
+ * error drop once the discovery fails.
+ */
+class DiscoveryFailureDropTestCase : public TestCase
+{
+    bool m_directDeferral; //!< whether direct deferral is enabled
+    uint32_t m_packets;    //!< number of data packets sent
+    uint32_t m_drops;      //!< number of route error drops of data packets
+
+    /**
+     * Drop trace sink
+     * \param header the IP header of the packet
+     * \param p the packet
+     * \param reason the drop reason
+     * \param ipv4 the Ipv4 of the node
+     * \param interface the interface
+     */
+    void Drop(const Ipv4Header& header,
+              Ptr<const Packet> p,
+              Ipv4L3Protocol::DropReason reason,
+              Ptr<Ipv4> ipv4,
+              uint32_t interface);
+
+  public:
+    /**
+     * Constructor
+     * \param directDeferral whether direct deferral is enabled
+     */
+    DiscoveryFailureDropTestCase(bool directDeferral);
+    void DoRun() override;
+};
+
+DiscoveryFailureDropTestCase::DiscoveryFailureDropTestCase(bool directDeferral)
+    : TestCase(directDeferral ? "Failed discovery drops are traced with direct deferral"
+                              : "Failed discovery drops are traced with loopback deferral"),
+      m_directDeferral(directDeferral),
+      m_packets(3),
+      m_drops(0)
+{
+}
+
+void
+DiscoveryFailureDropTestCase::Drop(const Ipv4Header& header,
+                                   Ptr<const Packet> p,
+                                   Ipv4L3Protocol::DropReason reason,
+                                   Ptr<Ipv4> ipv4,
+                                   uint32_t interface)
+{
+    if (header.GetProtocol() == UdpL4Protocol::PROT_NUMBER &&
+        reason == Ipv4L3Protocol::DROP_ROUTE_ERROR)
+    {
+        m_drops++;
+    }
+}
+
+void
+DiscoveryFailureDropTestCase::DoRun()
+{
+    RngSeedManager::SetSeed(12345);
+    RngSeedManager::SetRun(7);
+
+    NodeContainer nodes;
+    nodes.Create(1);
+    MadaodvHelper madaodv;
+    madaodv.Set("EnableHello", BooleanValue(false));
+    madaodv.Set("EnableDirectDeferral", BooleanValue(m_directDeferral));
+    InstallRow(nodes, 0, madaodv);
+
+    // Both sources are watched: a drop must be reported exactly once
+    nodes.Get(0)->GetObject<Ipv4L3Protocol>()->TraceConnectWithoutContext(
+        "Drop",
+        MakeCallback(&DiscoveryFailureDropTestCase::Drop, this));
+    nodes.Get(0)->GetObject<RoutingProtocol>()->TraceConnectWithoutContext(
+        "Drop",
+        MakeCallback(&DiscoveryFailureDropTestCase::Drop, this));
+
+    Ptr<Socket> tx =
+        Socket::CreateSocket(nodes.Get(0), TypeId::LookupByName("ns3::UdpSocketFactory"));
+    for (uint32_t i = 0; i < m_packets; ++i)
+    {
+        Simulator::ScheduleWithContext(
+            0,
+            Seconds(1 + 0.1 * i),
+            [tx]() {
+                tx->SendTo(Create<Packet>(100),
+                           0,
+                           InetSocketAddress(Ipv4Address("10.1.1.100"), 9));
+            });
+    }
+
+    // Past the last RREQ retry and the queue timeout
+    Simulator::Stop(Seconds(40));
+    Simulator::Run();
+    tx->Close();
+    Simulator::Destroy();
+
+    NS_TEST_ASSERT_MSG_EQ(m_drops, m_packets, "Every queued packet must be reported as dropped.");
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief An intermediate node repairs a broken route without telling the source
+ *
+ * A chain source - relay - repairer - destination carries a flow. The destination then jumps
+ * away from the repairer. If it lands next to the relay, the repairer finds the new route and
+ * the source never learns of the break. If it lands out of range of every node, the repair
+ * fails and the source receives a RERR.
+ */
+class LocalRepairTestCase : public TestCase
+{
+    bool m_succeed;            //!< whether the destination stays reachable
+    Ipv4Address m_destination; //!< destination address
+    uint32_t m_invalid;        //!< number of times the route of the source became invalid
+
+    /**
+     * Route state trace sink of the source
+     * \param dst the destination
+     * \param valid whether the route to dst became valid
+     */
+    void RouteState(Ipv4Address dst, bool valid);
+
+  public:
+    /**
+     * Constructor
+     * \param succeed whether the destination stays reachable
+     */
+    LocalRepairTestCase(bool succeed);
+    void DoRun() override;
+};
+
+LocalRepairTestCase::LocalRepairTestCase(bool succeed)
+    : TestCase(succeed ? "Local repair keeps a broken route alive"
+                       : "Failed local repair is reported to the source"),
+      m_succeed(succeed),
+      m_invalid(0)
+{
+}
+
+void
+LocalRepairTestCase::RouteState(Ipv4Address dst, bool valid)
+{
+    if (dst == m_destination && !valid)
+    {
+        m_invalid++;
+    }
+}
+
+void
+LocalRepairTestCase::DoRun()
+{
+    RngSeedManager::SetSeed(12345);
+    RngSeedManager::SetRun(7);
+
+    NodeContainer nodes;
+    nodes.Create(4);
+    MadaodvHelper madaodv;
+    madaodv.Set("EnableHello", BooleanValue(false));
+    madaodv.Set("EnableLocalRepair", BooleanValue(true));
+    Ipv4InterfaceContainer interfaces = InstallRow(nodes, 120, madaodv);
+    m_destination = interfaces.GetAddress(3);
+    nodes.Get(0)->GetObject<RoutingProtocol>()->TraceConnectWithoutContext(
+        "RouteState",
+        MakeCallback(&LocalRepairTestCase::RouteState, this));
+
+    UdpFlow flow;
+    flow.Install(nodes.Get(0), nodes.Get(3), m_destination, Seconds(1), Seconds(9), Seconds(0.25));
+    // Next to the relay only, or far from everybody
+    Vector position = m_succeed ? Vector(120, -110, 0) : Vector(360, 1000, 0);
+    Simulator::Schedule(Seconds(5),
+                        &MobilityModel::SetPosition,
+                        nodes.Get(3)->GetObject<MobilityModel>(),
+                        position);
+
+    Simulator::Stop(Seconds(10));
+    Simulator::Run();
+    flow.Close();
+    Simulator::Destroy();
+
+    NS_TEST_ASSERT_MSG_GT(flow.GetReceived(Seconds(1), Seconds(5)),
+                          0,
+                          "The flow must be delivered before the break.");
+    if (m_succeed)
+    {
+        NS_TEST_ASSERT_MSG_GT(flow.GetReceived(Seconds(6), Seconds(10)),
+                              0,
+                              "The flow must be delivered over the repaired route.");
+        NS_TEST_ASSERT_MSG_EQ(m_invalid, 0, "The source must not learn of a repaired break.");
+    }
+    else
+    {
+        NS_TEST_ASSERT_MSG_EQ(flow.GetReceived(Seconds(6), Seconds(10)),
+                              0,
+                              "The destination is out of reach.");
+        NS_TEST_ASSERT_MSG_GT(m_invalid, 0, "The failed repair must be reported to the source.");
+    }
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Adaptive hellos slow down while the neighbor set is stable and speed up on a change
+ *
+ * Two nodes in range keep exchanging hellos with EnableAdaptiveHello: once their interval reached
+ * MaxHelloInterval, they send far fewer hellos than at HelloInterval and stay neighbors through
+ * the advertised lifetime. A third node then comes into range: the first node must fall back to
+ * HelloInterval as soon as it learns the newcomer.
+ */
+class TrickleHelloTestCase : public TestCase
+{
+    Ipv4Address m_neighbor;     //!< address of the neighbor of the first node
+    Ipv4Address m_newcomer;     //!< address of the node which comes into range
+    uint32_t m_invalid;         //!< number of times the route to the neighbor became invalid
+    Time m_learned;             //!< time the first node learned the newcomer
+    std::vector<Time> m_hellos; //!< times the first node sent a hello
+
+    /**
+     * Route state trace sink of the first node
+     * \param dst the destination
+     * \param valid whether the route to dst became valid
+     */
+    void RouteState(Ipv4Address dst, bool valid);
+    /**
+     * IPv4 transmit trace sink of the first node
+     * \param p the packet, with its IP header
+     * \param ipv4 the Ipv4 of the node
+     * \param interface the output interface
+     */
+    void Tx(Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface);
+    /**
+     * Count the hellos sent by the first node in a time window
+     * \param from start of the window
+     * \param to end of the window
+     * \returns the number of hellos sent in [from, to)
+     */
+    uint32_t CountHellos(Time from, Time to) const;
+
+  public:
+    TrickleHelloTestCase();
+    void DoRun() override;
+};
+
+TrickleHelloTestCase::TrickleHelloTestCase()
+    : TestCase("Adaptive hello interval grows while stable and resets on a new neighbor"),
+      m_invalid(0)
+{
+}
+
+void
+TrickleHelloTestCase::RouteState(Ipv4Address dst, bool valid)
+{
+    if (dst == m_neighbor && !valid)
+    {
+        m_invalid++;
+    }
+    if (dst == m_newcomer && valid && m_learned.IsZero())
+    {
+        m_learned = Simulator::Now();
+    }
+}
+
+void
+TrickleHelloTestCase::Tx(Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+    // Without data traffic, the only broadcasts are the hellos
+    Ipv4Header header;
+    p->PeekHeader(header);
+    if (header.GetDestination().IsSubnetDirectedBroadcast(Ipv4Mask("255.255.255.0")) ||
+        header.GetDestination().IsBroadcast())
+    {
+        m_hellos.push_back(Simulator::Now());
+    }
+}
+
+uint32_t
+TrickleHelloTestCase::CountHellos(Time from, Time to) const
+{
+    return std::count_if(m_hellos.begin(), m_hellos.end(), [from, to](Time t) {
+        return t >= from && t < to;
+    });
+}
+
+void
+TrickleHelloTestCase::DoRun()
+{
+    RngSeedManager::SetSeed(12345);
+    RngSeedManager::SetRun(7);
+
+    // Two neighbors, and a newcomer far away which later comes in range of the first node only
+    NodeContainer nodes;
+    nodes.Create(3);
+    Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator>();
+    positions->Add(Vector(0, 0, 0));
+    positions->Add(Vector(120, 0, 0));
+    positions->Add(Vector(0, 1000, 0));
+    MadaodvHelper madaodv;
+    madaodv.Set("EnableHello", BooleanValue(true));
+    madaodv.Set("EnableAdaptiveHello", BooleanValue(true));
+    madaodv.Set("HelloInterval", TimeValue(Seconds(1)));
+    madaodv.Set("MaxHelloInterval", TimeValue(Seconds(8)));
+    Ipv4InterfaceContainer interfaces = InstallNodes(nodes, positions, madaodv);
+    m_neighbor = interfaces.GetAddress(1);
+    m_newcomer = interfaces.GetAddress(2);
+
+    nodes.Get(0)->GetObject<RoutingProtocol>()->TraceConnectWithoutContext(
+        "RouteState",
+        MakeCallback(&TrickleHelloTestCase::RouteState, this));
+    nodes.Get(0)->GetObject<Ipv4L3Protocol>()->TraceConnectWithoutContext(
+        "Tx",
+        MakeCallback(&TrickleHelloTestCase::Tx, this));
+    Simulator::Schedule(Seconds(40),
+                        &MobilityModel::SetPosition,
+                        nodes.Get(2)->GetObject<MobilityModel>(),
+                        Vector(-120, 0, 0));
+
+    Simulator::Stop(Seconds(60));
+    Simulator::Run();
+    Simulator::Destroy();
+
+    // At HelloInterval, 24 hellos would be sent in the window
+    NS_TEST_ASSERT_MSG_GT(CountHellos(Seconds(16), Seconds(40)),
+                          0,
+                          "Hellos must still be sent at the maximum interval.");
+    NS_TEST_ASSERT_MSG_LT(CountHellos(Seconds(16), Seconds(40)),
+                          6,
+                          "The interval must grow while the neighbor set is stable.");
+    NS_TEST_ASSERT_MSG_EQ(m_invalid,
+                          0,
+                          "The neighbor must not expire while the interval grows.");
+    NS_TEST_ASSERT_MSG_GT(m_learned, Seconds(40), "The newcomer must be learned from its hellos.");
+    // After the reset, one hello in the first interval and the next one an interval later
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(CountHellos(m_learned, m_learned + Seconds(4)),
+                                2,
+                                "The interval must fall back to HelloInterval.");
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief A route over a fading link is rediscovered before the link breaks
+ *
+ * A chain source - relay - destination carries a flow, and the relay slowly walks away from both.
+ * With EnablePreemptiveMaintenance, the source must see the signal of the relay fade and send a
+ * RREQ for the destination while its route is still valid.
+ */
+class LinkBreakPredictionTestCase : public TestCase
+{
+    Ipv4Address m_source;      //!< source address
+    Ipv4Address m_destination; //!< destination address
+    Time m_request;            //!< time of the first RREQ of the source after the flow started
+    Time m_broken;             //!< time the route of the source first became invalid
+
+    /**
+     * Route state trace sink of the source
+     * \param dst the destination
+     * \param valid whether the route to dst became valid
+     */
+    void RouteState(Ipv4Address dst, bool valid);
+    /**
+     * IPv4 transmit trace sink of the source
+     * \param p the packet, with its IP header
+     * \param ipv4 the Ipv4 of the node
+     * \param interface the output interface
+     */
+    void Tx(Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface);
+
+  public:
+    LinkBreakPredictionTestCase();
+    void DoRun() override;
+};
+
+LinkBreakPredictionTestCase::LinkBreakPredictionTestCase()
+    : TestCase("A route over a fading link is rediscovered before it breaks"),
+      m_request(Time::Max()),
+      m_broken(Time::Max())
+{
+}
+
+void
+LinkBreakPredictionTestCase::RouteState(Ipv4Address dst, bool valid)
+{
+    if (dst == m_destination && !valid && m_broken == Time::Max())
+    {
+        m_broken = Simulator::Now();
+    }
+}
+
+void
+LinkBreakPredictionTestCase::Tx(Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+    RreqHeader rreq;
+    // The first discovery is over before the relay moves
+    if (Simulator::Now() > Seconds(3) && m_request == Time::Max() &&
+        PeekMessage(p, MADAODVTYPE_RREQ, rreq) && rreq.GetOrigin() == m_source &&
+        rreq.GetDst() == m_destination)
+    {
+        m_request = Simulator::Now();
+    }
+}
+
+void
+LinkBreakPredictionTestCase::DoRun()
+{
+    RngSeedManager::SetSeed(12345);
+    RngSeedManager::SetRun(7);
+
+    NodeContainer nodes;
+    nodes.Create(3);
+    // Hellos give the source the signal strength of the relay. The threshold is crossed about
+    // 120 m away from the relay, well before the link breaks.
+    MadaodvHelper madaodv;
+    madaodv.Set("EnableHello", BooleanValue(true));
+    madaodv.Set("EnablePreemptiveMaintenance", BooleanValue(true));
+    madaodv.Set("PreemptiveRssiThreshold", DoubleValue(-93));
+    Ipv4InterfaceContainer interfaces = InstallRow(nodes, 100, madaodv);
+    m_source = interfaces.GetAddress(0);
+    m_destination = interfaces.GetAddress(2);
+    nodes.Get(0)->GetObject<RoutingProtocol>()->TraceConnectWithoutContext(
+        "RouteState",
+        MakeCallback(&LinkBreakPredictionTestCase::RouteState, this));
+    nodes.Get(0)->GetObject<Ipv4L3Protocol>()->TraceConnectWithoutContext(
+        "Tx",
+        MakeCallback(&LinkBreakPredictionTestCase::Tx, this));
+
+    UdpFlow flow;
+    flow.Install(nodes.Get(0), nodes.Get(2), m_destination, Seconds(1), Seconds(45), Seconds(0.25));
+    // The relay walks away from the line at 5 m/s
+    for (uint32_t i = 1; i <= 40; ++i)
+    {
+        Simulator::Schedule(Seconds(5 + i),
+                            &MobilityModel::SetPosition,
+                            nodes.Get(1)->GetObject<MobilityModel>(),
+                            Vector(100, 5 * i, 0));
+    }
+
+    Simulator::Stop(Seconds(50));
+    Simulator::Run();
+    flow.Close();
+    Simulator::Destroy();
+
+    NS_TEST_ASSERT_MSG_GT(flow.GetReceived(Seconds(1), Seconds(5)),
+                          0,
+                          "The flow must be delivered before the relay moves.");
+    NS_TEST_ASSERT_MSG_LT(m_request,
+                          Time::Max(),
+                          "The source must look for a new route over the fading link.");
+    NS_TEST_ASSERT_MSG_GT(m_request,
+                          Seconds(5),
+                          "The link must not be predicted to fail before the relay moves.");
+    NS_TEST_ASSERT_MSG_LT(m_request,
+                          m_broken,
+                          "The RREQ must be sent while the route is still valid.");
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief A node learns a route from a RREP it overhears
+ *
+ * The source discovers a route along a chain of relays. A bystander next to the middle of the
+ * chain, out of range of both ends, is not on the route. With EnablePromiscuousLearning, it
+ * overhears the RREP unicast between two relays and must then reach the destination without a
+ * route discovery of its own.
+ */
+class OverheardReplyTestCase : public TestCase
+{
+    Ipv4Address m_bystander;   //!< bystander address
+    Ipv4Address m_destination; //!< destination address
+    uint32_t m_requests;       //!< number of RREQs originated by the bystander
+    uint32_t m_replies;        //!< number of RREPs sent by the bystander
+
+    /**
+     * IPv4 transmit trace sink of the bystander
+     * \param p the packet, with its IP header
+     * \param ipv4 the Ipv4 of the node
+     * \param interface the output interface
+     */
+    void Tx(Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface);
+
+  public:
+    OverheardReplyTestCase();
+    void DoRun() override;
+};
+
+OverheardReplyTestCase::OverheardReplyTestCase()
+    : TestCase("A route learned from an overheard RREP is used without discovery"),
+      m_requests(0),
+      m_replies(0)
+{
+}
+
+void
+OverheardReplyTestCase::Tx(Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+    RreqHeader rreq;
+    if (PeekMessage(p, MADAODVTYPE_RREQ, rreq) && rreq.GetOrigin() == m_bystander)
+    {
+        m_requests++;
+    }
+    RrepHeader rrep;
+    if (PeekMessage(p, MADAODVTYPE_RREP, rrep) && rrep.GetDst() == m_destination)
+    {
+        m_replies++;
+    }
+}
+
+void
+OverheardReplyTestCase::DoRun()
+{
+    RngSeedManager::SetSeed(12345);
+    RngSeedManager::SetRun(7);
+
+    // Source, three relays and destination on a row, the bystander hears the first two relays
+    // only. No hellos, so that neighbors are learned from the flooded RREQ only.
+    NodeContainer nodes;
+    nodes.Create(6);
+    Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator>();
+    for (uint32_t i = 0; i < 5; ++i)
+    {
+        positions->Add(Vector(120 * i, 0, 0));
+    }
+    positions->Add(Vector(160, 80, 0));
+    MadaodvHelper madaodv;
+    madaodv.Set("EnableHello", BooleanValue(false));
+    madaodv.Set("EnablePromiscuousLearning", BooleanValue(true));
+    Ipv4InterfaceContainer interfaces = InstallNodes(nodes, positions, madaodv);
+    m_destination = interfaces.GetAddress(4);
+    m_bystander = interfaces.GetAddress(5);
+    nodes.Get(5)->GetObject<Ipv4L3Protocol>()->TraceConnectWithoutContext(
+        "Tx",
+        MakeCallback(&OverheardReplyTestCase::Tx, this));
+
+    Simulator::ScheduleWithContext(0,
+                                   Seconds(1),
+                                   &RoutingProtocol::RequestRoute,
+                                   nodes.Get(0)->GetObject<RoutingProtocol>(),
+                                   m_destination);
+    UdpFlow flow;
+    flow.Install(nodes.Get(5), nodes.Get(4), m_destination, Seconds(2), Seconds(4), Seconds(0.25));
+
+    Simulator::Stop(Seconds(5));
+    Simulator::Run();
+    flow.Close();
+    Simulator::Destroy();
+
+    NS_TEST_ASSERT_MSG_EQ(m_replies, 0, "The bystander must not be on the discovered route.");
+    NS_TEST_ASSERT_MSG_GT(flow.GetReceived(Seconds(2), Seconds(5)),
+                          0,
+                          "The flow of the bystander must be delivered.");
+    NS_TEST_ASSERT_MSG_EQ(m_requests,
+                          0,
+                          "The bystander must use the overheard route without discovery.");
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief The destination answers the best copy of a RREQ heard in the holding window
+ *
+ * The source reaches the destination over a two-hop path and a three-hop path. The relay of the
+ * short path is busy sending a burst, so its copy of the RREQ waits behind the burst and reaches
+ * the destination after the copy of the long path. With RreqHoldTime, the destination must hold
+ * its RREP for the window and then send it over the short path.
+ */
+class RreqHoldTestCase : public TestCase
+{
+    Ipv4Address m_source;       //!< source address
+    Ipv4Address m_destination;  //!< destination address
+    Ipv4Address m_shortRelay;   //!< relay of the two-hop path
+    Ipv4Address m_longRelay;    //!< last relay of the three-hop path
+    Ipv4Address m_firstCopy;    //!< neighbor the destination got the first RREQ copy from
+    Time m_firstCopyTime;       //!< time the destination got the first RREQ copy
+    Ipv4Address m_replyNextHop; //!< next hop of the RREP of the destination
+    Time m_replyTime;           //!< time the destination sent its RREP
+
+    /**
+     * IPv4 receive trace sink of the destination
+     * \param p the packet, with its IP header
+     * \param ipv4 the Ipv4 of the node
+     * \param interface the input interface
+     */
+    void Rx(Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface);
+    /**
+     * IPv4 transmit trace sink of the destination
+     * \param p the packet, with its IP header
+     * \param ipv4 the Ipv4 of the node
+     * \param interface the output interface
+     */
+    void Tx(Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface);
+
+  public:
+    RreqHoldTestCase();
+    void DoRun() override;
+};
+
+RreqHoldTestCase::RreqHoldTestCase()
+    : TestCase("The destination answers the best RREQ copy of the holding window")
+{
+}
+
+void
+RreqHoldTestCase::Rx(Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+    RreqHeader rreq;
+    if (m_firstCopy == Ipv4Address() && PeekMessage(p, MADAODVTYPE_RREQ, rreq) &&
+        rreq.GetOrigin() == m_source && rreq.GetDst() == m_destination)
+    {
+        Ipv4Header header;
+        p->PeekHeader(header);
+        m_firstCopy = header.GetSource();
+        m_firstCopyTime = Simulator::Now();
+    }
+}
+
+void
+RreqHoldTestCase::Tx(Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface)
+{
+    RrepHeader rrep;
+    if (m_replyNextHop == Ipv4Address() && PeekMessage(p, MADAODVTYPE_RREP, rrep) &&
+        rrep.GetOrigin() == m_source && rrep.GetDst() == m_destination)
+    {
+        Ipv4Header header;
+        p->PeekHeader(header);
+        m_replyNextHop = header.GetDestination();
+        m_replyTime = Simulator::Now();
+    }
+}
+
+void
+RreqHoldTestCase::DoRun()
+{
+    RngSeedManager::SetSeed(12345);
+    RngSeedManager::SetRun(7);
+
+    // Source, destination, the relay of the short path between them, and the two relays of the
+    // long path above them
+    NodeContainer nodes;
+    nodes.Create(5);
+    Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator>();
+    positions->Add(Vector(0, 0, 0));
+    positions->Add(Vector(220, 0, 0));
+    positions->Add(Vector(110, 0, 0));
+    positions->Add(Vector(50, 110, 0));
+    positions->Add(Vector(170, 110, 0));
+    MadaodvHelper madaodv;
+    madaodv.Set("EnableHello", BooleanValue(false));
+    madaodv.Set("RreqHoldTime", TimeValue(MilliSeconds(500)));
+    // A single RREQ reaching the destination over both paths, without expanding ring
+    madaodv.Set("TtlStart", UintegerValue(5));
+    Ipv4InterfaceContainer interfaces = InstallNodes(nodes, positions, madaodv);
+    m_source = interfaces.GetAddress(0);
+    m_destination = interfaces.GetAddress(1);
+    m_shortRelay = interfaces.GetAddress(2);
+    m_longRelay = interfaces.GetAddress(4);
+    nodes.Get(1)->GetObject<Ipv4L3Protocol>()->TraceConnectWithoutContext(
+        "Rx",
+        MakeCallback(&RreqHoldTestCase::Rx, this));
+    nodes.Get(1)->GetObject<Ipv4L3Protocol>()->TraceConnectWithoutContext(
+        "Tx",
+        MakeCallback(&RreqHoldTestCase::Tx, this));
+
+    // The burst of the short relay to the source fills its MAC queue when the RREQ arrives
+    UdpFlow burst;
+    burst.Install(nodes.Get(2),
+                  nodes.Get(0),
+                  m_source,
+                  Seconds(1),
+                  Seconds(1.6),
+                  MicroSeconds(200));
+    Simulator::ScheduleWithContext(0,
+                                   Seconds(1.5),
+                                   &RoutingProtocol::RequestRoute,
+                                   nodes.Get(0)->GetObject<RoutingProtocol>(),
+                                   m_destination);
+
+    Simulator::Stop(Seconds(4));
+    Simulator::Run();
+    burst.Close();
+    Simulator::Destroy();
+
+    NS_TEST_ASSERT_MSG_EQ(m_firstCopy,
+                          m_longRelay,
+                          "The first RREQ copy must come over the long path.");
+    NS_TEST_ASSERT_MSG_EQ(m_replyNextHop,
+                          m_shortRelay,
+                          "The RREP must follow the shorter reverse route of the later copy.");
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(m_replyTime - m_firstCopyTime,
+                                MilliSeconds(500),
+                                "The RREP must be held for the window.");
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief The rebroadcast jitter of a RREQ grows with the neighbor count of the relay
+ *
+ * The source sits between a sparse relay, which only hears the source, and a dense relay
+ * surrounded by nine more nodes. With JitterPerNeighbor, the delay between the first copy of a
+ * RREQ and its rebroadcast must stay within the short window of the sparse relay, while the
+ * dense relay draws from a window five times longer.
+ */
+class JitterDensityTestCase : public TestCase
+{
+    Ipv4Address m_source;                                  //!< source address
+    std::map<std::pair<std::string, uint32_t>, Time> m_rx; //!< first RREQ copy per relay and ID
+    std::map<std::string, Time> m_maxDelay;                //!< longest rebroadcast delay per relay
+    std::map<std::string, uint32_t> m_forwarded;           //!< RREQs rebroadcast per relay
+
+    /**
+     * IPv4 receive trace sink of the relays
+     * \param relay the relay, "sparse" or "dense"
+     * \param p the packet, with its IP header
+     * \param ipv4 the Ipv4 of the node
+     * \param interface the input interface
+     */
+    void Rx(std::string relay, Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface);
+    /**
+     * IPv4 transmit trace sink of the relays
+     * \param relay the relay, "sparse" or "dense"
+     * \param p the packet, with its IP header
+     * \param ipv4 the Ipv4 of the node
+     * \param interface the output interface
+     */
+    void Tx(std::string relay, Ptr<const Packet> p, Ptr<Ipv4> ipv4, uint32_t interface);
+
+  public:
+    JitterDensityTestCase();
+    void DoRun() override;
+};
+
+JitterDensityTestCase::JitterDensityTestCase()
+    : TestCase("The RREQ rebroadcast jitter scales with the neighbor count")
+{
+}
+
+void
+JitterDensityTestCase::Rx(std::string relay,
+                          Ptr<const Packet> p,
+                          Ptr<Ipv4> ipv4,
+                          uint32_t interface)
+{
+    RreqHeader rreq;
+    if (PeekMessage(p, MADAODVTYPE_RREQ, rreq) && rreq.GetOrigin() == m_source)
+    {
+        // Keep the first copy only, the rebroadcast is scheduled when it arrives
+        m_rx.insert(std::make_pair(std::make_pair(relay, rreq.GetId()), Simulator::Now()));
+    }
+}
+
+void
+JitterDensityTestCase::Tx(std::string relay,
+                          Ptr<const Packet> p,
+                          Ptr<Ipv4> ipv4,
+                          uint32_t interface)
+{
+    RreqHeader rreq;
+    if (!PeekMessage(p, MADAODVTYPE_RREQ, rreq) || rreq.GetOrigin() != m_source)
+    {
+        return;
+    }
+    std::map<std::pair<std::string, uint32_t>, Time>::const_iterator i =
+        m_rx.find(std::make_pair(relay, rreq.GetId()));
+    if (i != m_rx.end())
+    {
+        m_maxDelay[relay] = std::max(m_maxDelay[relay], Simulator::Now() - i->second);
+        ++m_forwarded[relay];
+    }
+}
+
+void
+JitterDensityTestCase::DoRun()
+{
+    RngSeedManager::SetSeed(12345);
+    RngSeedManager::SetRun(7);
+
+    // Source, the sparse relay on its right, and the dense relay on its left with nine nodes on
+    // a half circle beyond it, out of the range of the sparse relay
+    NodeContainer nodes;
+    nodes.Create(12);
+    Ptr<ListPositionAllocator> positions = CreateObject<ListPositionAllocator>();
+    positions->Add(Vector(0, 0, 0));
+    positions->Add(Vector(120, 0, 0));
+    positions->Add(Vector(-120, 0, 0));
+    for (uint32_t i = 0; i < 9; ++i)
+    {
+        double angle = M_PI / 2 + i * M_PI / 8;
+        positions->Add(Vector(-120 + 40 * std::cos(angle), 40 * std::sin(angle), 0));
+    }
+    MadaodvHelper madaodv;
+    madaodv.Set("JitterPerNeighbor", TimeValue(MilliSeconds(20)));
+    madaodv.Set("MaxJitter", TimeValue(Seconds(1)));
+    // Forward every RREQ right away, without expanding ring
+    madaodv.Set("TtlStart", UintegerValue(5));
+    Ipv4InterfaceContainer interfaces = InstallNodes(nodes, positions, madaodv);
+    m_source = interfaces.GetAddress(0);
+    for (uint32_t i = 1; i <= 2; ++i)
+    {
+        std::string relay = i == 1 ? "sparse" : "dense";
+        nodes.Get(i)->GetObject<Ipv4L3Protocol>()->TraceConnect(
+            "Rx",
+            relay,
+            MakeCallback(&JitterDensityTestCase::Rx, this));
+        nodes.Get(i)->GetObject<Ipv4L3Protocol>()->TraceConnect(
+            "Tx",
+            relay,
+            MakeCallback(&JitterDensityTestCase::Tx, this));
+    }
+
+    // Discover unassigned addresses once the hellos have filled the neighbor lists, so that every
+    // RREQ floods the whole network
+    for (uint32_t i = 0; i < 10; ++i)
+    {
+        Simulator::ScheduleWithContext(0,
+                                       Seconds(3 + i * 0.5),
+                                       &RoutingProtocol::RequestRoute,
+                                       nodes.Get(0)->GetObject<RoutingProtocol>(),
+                                       Ipv4Address(0x0a010164 + i));
+    }
+
+    Simulator::Stop(Seconds(9));
+    Simulator::Run();
+    Simulator::Destroy();
+
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(m_forwarded["sparse"],
+                                5,
+                                "The sparse relay must rebroadcast the RREQs.");
+    NS_TEST_ASSERT_MSG_GT_OR_EQ(m_forwarded["dense"],
+                                5,
+                                "The dense relay must rebroadcast the RREQs.");
+    // One neighbor, the source
+    NS_TEST_ASSERT_MSG_LT_OR_EQ(m_maxDelay["sparse"],
+                                MilliSeconds(40),
+                                "The sparse relay must jitter within its short window.");
+    NS_TEST_ASSERT_MSG_GT(m_maxDelay["dense"],
+                          MilliSeconds(40),
+                          "The dense relay must jitter beyond the window of the sparse relay.");
+    // Ten neighbors, the source and the nodes around it
+    NS_TEST_ASSERT_MSG_LT_OR_EQ(m_maxDelay["dense"],
+                                MilliSeconds(220),
+                                "The dense relay must jitter within its scaled window.");
+}
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief MADAODV data path test suite
+ */
+class MadaodvDataPathTestSuite : public TestSuite
+{
+  public:
+    MadaodvDataPathTestSuite()
+        : TestSuite("routing-madaodv-data-path", SYSTEM)
+    {
+        AddTestCase(new DataDeliveryTestCase(true), TestCase::QUICK);
+        AddTestCase(new DataDeliveryTestCase(false), TestCase::QUICK);
+        AddTestCase(new RouteInputCopyTestCase(), TestCase::QUICK);
+        AddTestCase(new HelloNeighborTestCase(), TestCase::QUICK);
+        AddTestCase(new FlowPinningTestCase(), TestCase::QUICK);
+        AddTestCase(new DiscoveryFailureDropTestCase(false), TestCase::QUICK);
+        AddTestCase(new DiscoveryFailureDropTestCase(true), TestCase::QUICK);
+        AddTestCase(new LocalRepairTestCase(true), TestCase::QUICK);
+        AddTestCase(new LocalRepairTestCase(false), TestCase::QUICK);
+        AddTestCase(new TrickleHelloTestCase(), TestCase::QUICK);
+        AddTestCase(new LinkBreakPredictionTestCase(), TestCase::QUICK);
+        AddTestCase(new OverheardReplyTestCase(), TestCase::QUICK);
+        AddTestCase(new RreqHoldTestCase(), TestCase::QUICK);
+        AddTestCase(new JitterDensityTestCase(), TestCase::QUICK);
+    }
+} g_madaodvDataPathTestSuite; ///< the test suite
+
+} // namespace madaodv
+} // namespace ns3
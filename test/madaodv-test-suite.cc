@@ -53,6 +53,8 @@ struct NeighborTest : public TestCase
     void CheckTimeout2();
     /// Check timeout function 3
     void CheckTimeout3();
+    /// Refresh one neighbor
+    void Refresh();
     /// The Neighbors
     Neighbors* neighbor;
 };
@@ -69,6 +71,11 @@ NeighborTest::CheckTimeout1()
     NS_TEST_EXPECT_MSG_EQ(neighbor->IsNeighbor(Ipv4Address("1.1.1.1")), true, "Neighbor exists");
     NS_TEST_EXPECT_MSG_EQ(neighbor->IsNeighbor(Ipv4Address("2.2.2.2")), true, "Neighbor exists");
     NS_TEST_EXPECT_MSG_EQ(neighbor->IsNeighbor(Ipv4Address("3.3.3.3")), true, "Neighbor exists");
+    NS_TEST_EXPECT_MSG_EQ(neighbor->GetNeighborCount(), 4, "Four neighbors");
+    double rssi;
+    NS_TEST_EXPECT_MSG_EQ(neighbor->GetRssi(Ipv4Address("1.2.3.4"), rssi),
+                          false,
+                          "No signal strength sample");
 }
 
 void
@@ -84,6 +91,7 @@ NeighborTest::CheckTimeout2()
                           false,
                           "Neighbor doesn't exist");
     NS_TEST_EXPECT_MSG_EQ(neighbor->IsNeighbor(Ipv4Address("3.3.3.3")), true, "Neighbor exists");
+    NS_TEST_EXPECT_MSG_EQ(neighbor->GetNeighborCount(), 1, "One neighbor left");
 }
 
 void
@@ -101,6 +109,21 @@ NeighborTest::CheckTimeout3()
     NS_TEST_EXPECT_MSG_EQ(neighbor->IsNeighbor(Ipv4Address("3.3.3.3")),
                           false,
                           "Neighbor doesn't exist");
+    NS_TEST_EXPECT_MSG_EQ(neighbor->GetLinkLifetime(Ipv4Address("3.3.3.3")),
+                          Seconds(4),
+                          "Link was up from 0 s until last heard at 4 s");
+    NS_TEST_EXPECT_MSG_EQ(neighbor->GetLinkLifetime(Ipv4Address("1.1.1.1")),
+                          Seconds(0),
+                          "Link was never refreshed");
+    NS_TEST_EXPECT_MSG_EQ(neighbor->GetLinkLifetime(Ipv4Address("4.3.2.1")),
+                          Seconds(1),
+                          "Unknown neighbor gets the average over all links");
+}
+
+void
+NeighborTest::Refresh()
+{
+    neighbor->Update(Ipv4Address("3.3.3.3"), Seconds(1));
 }
 
 void
@@ -127,6 +150,7 @@ NeighborTest::DoRun()
     neighbor->Update(Ipv4Address("3.3.3.3"), Seconds(20));
 
     Simulator::Schedule(Seconds(2), &NeighborTest::CheckTimeout1, this);
+    Simulator::Schedule(Seconds(4), &NeighborTest::Refresh, this);
     Simulator::Schedule(Seconds(15), &NeighborTest::CheckTimeout2, this);
     Simulator::Schedule(Seconds(30), &NeighborTest::CheckTimeout3, this);
     Simulator::Run();
@@ -300,6 +324,236 @@ struct RrepAckHeaderTest : public TestCase
     }
 };
 
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Unit test for the neighbor set extension
+ */
+struct NeighborSetExtensionTest : public TestCase
+{
+    NeighborSetExtensionTest()
+        : TestCase("MADAODV neighbor set extension")
+    {
+    }
+
+    void DoRun() override
+    {
+        std::vector<Ipv4Address> neighbors;
+        for (uint32_t i = 1; i <= 20; ++i)
+        {
+            neighbors.push_back(Ipv4Address(0x0a000000 + i));
+        }
+        NeighborSetExtension h;
+        NS_TEST_EXPECT_MSG_EQ(h.MayContain(neighbors[0]), false, "Empty set");
+        h.SetNeighbors(neighbors);
+        NS_TEST_EXPECT_MSG_EQ(h.GetSerializedSize(), 2 + 25, "10 bits per neighbor");
+        for (std::vector<Ipv4Address>::const_iterator i = neighbors.begin(); i != neighbors.end();
+             ++i)
+        {
+            NS_TEST_EXPECT_MSG_EQ(h.MayContain(*i), true, "No false negative");
+        }
+
+        Ptr<Packet> p = Create<Packet>();
+        p->AddHeader(h);
+        ExtensionHeader e;
+        p->PeekHeader(e);
+        NS_TEST_EXPECT_MSG_EQ((uint16_t)e.GetType(), MADAODVEXT_NEIGHBOR_SET, "Extension type");
+        NS_TEST_EXPECT_MSG_EQ((uint16_t)e.GetLength(), 25, "Extension length");
+        NeighborSetExtension h2;
+        uint32_t bytes = p->RemoveHeader(h2);
+        NS_TEST_EXPECT_MSG_EQ(bytes, 27, "Extension is 27 bytes long");
+        NS_TEST_EXPECT_MSG_EQ(h, h2, "Round trip serialization works");
+    }
+};
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Unit test for the multi-destination extension
+ */
+struct MultiDestinationExtensionTest : public TestCase
+{
+    MultiDestinationExtensionTest()
+        : TestCase("MADAODV multi-destination extension")
+    {
+    }
+
+    void DoRun() override
+    {
+        MultiDestinationExtension h;
+        NS_TEST_EXPECT_MSG_EQ(h.AddDestination(Ipv4Address("1.2.3.4"), 7, false), true, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(h.AddDestination(Ipv4Address("4.3.2.1"), 0, true), true, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(h.GetDestinations().size(), 2, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(h.GetDestinations()[1].unknownSeqNo, true, "trivial");
+
+        Ptr<Packet> p = Create<Packet>();
+        p->AddHeader(h);
+        ExtensionHeader e;
+        p->PeekHeader(e);
+        NS_TEST_EXPECT_MSG_EQ((uint16_t)e.GetType(),
+                              MADAODVEXT_MULTI_DESTINATION,
+                              "Extension type");
+        NS_TEST_EXPECT_MSG_EQ((uint16_t)e.GetLength(), 18, "Extension length");
+        MultiDestinationExtension h2;
+        uint32_t bytes = p->RemoveHeader(h2);
+        NS_TEST_EXPECT_MSG_EQ(bytes, 20, "Extension is 20 bytes long");
+        NS_TEST_EXPECT_MSG_EQ(h, h2, "Round trip serialization works");
+
+        for (uint32_t k = 2; k < MultiDestinationExtension::MAX_DESTINATIONS; ++k)
+        {
+            NS_TEST_EXPECT_MSG_EQ(h.AddDestination(Ipv4Address(0x0a000000 + k), k, false),
+                                  true,
+                                  "trivial");
+        }
+        NS_TEST_EXPECT_MSG_EQ(h.AddDestination(Ipv4Address("5.6.7.8"), 1, false),
+                              false,
+                              "Extension length fits in one byte");
+    }
+};
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Unit test for the path accumulation extension
+ */
+struct PathExtensionTest : public TestCase
+{
+    PathExtensionTest()
+        : TestCase("MADAODV path accumulation extension")
+    {
+    }
+
+    void DoRun() override
+    {
+        PathExtension h;
+        NS_TEST_EXPECT_MSG_EQ(h.GetSerializedSize(), 2, "Empty path");
+        NS_TEST_EXPECT_MSG_EQ(h.AddNode(Ipv4Address("1.2.3.4")), true, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(h.AddNode(Ipv4Address("4.3.2.1")), true, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(h.GetPath().back(), Ipv4Address("4.3.2.1"), "Appended at the end");
+
+        Ptr<Packet> p = Create<Packet>();
+        p->AddHeader(h);
+        ExtensionHeader e;
+        p->PeekHeader(e);
+        NS_TEST_EXPECT_MSG_EQ((uint16_t)e.GetType(), MADAODVEXT_PATH, "Extension type");
+        NS_TEST_EXPECT_MSG_EQ((uint16_t)e.GetLength(), 8, "Extension length");
+        PathExtension h2;
+        uint32_t bytes = p->RemoveHeader(h2);
+        NS_TEST_EXPECT_MSG_EQ(bytes, 10, "Extension is 10 bytes long");
+        NS_TEST_EXPECT_MSG_EQ(h, h2, "Round trip serialization works");
+
+        for (uint32_t k = 2; k < PathExtension::MAX_NODES; ++k)
+        {
+            NS_TEST_EXPECT_MSG_EQ(h.AddNode(Ipv4Address(0x0a000000 + k)), true, "trivial");
+        }
+        NS_TEST_EXPECT_MSG_EQ(h.AddNode(Ipv4Address("5.6.7.8")),
+                              false,
+                              "Extension length fits in one byte");
+    }
+};
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Unit test for the path load extension
+ */
+struct LoadExtensionTest : public TestCase
+{
+    LoadExtensionTest()
+        : TestCase("MADAODV path load extension")
+    {
+    }
+
+    void DoRun() override
+    {
+        LoadExtension h(3);
+        NS_TEST_EXPECT_MSG_EQ(h.GetLoad(), 3, "trivial");
+        h.SetLoad(h.GetLoad() + 70000);
+        NS_TEST_EXPECT_MSG_EQ(h.GetLoad(), 70003, "trivial");
+
+        Ptr<Packet> p = Create<Packet>();
+        p->AddHeader(h);
+        ExtensionHeader e;
+        p->PeekHeader(e);
+        NS_TEST_EXPECT_MSG_EQ((uint16_t)e.GetType(), MADAODVEXT_LOAD, "Extension type");
+        NS_TEST_EXPECT_MSG_EQ((uint16_t)e.GetLength(), 4, "Extension length");
+        LoadExtension h2;
+        uint32_t bytes = p->RemoveHeader(h2);
+        NS_TEST_EXPECT_MSG_EQ(bytes, 6, "Extension is 6 bytes long");
+        NS_TEST_EXPECT_MSG_EQ(h, h2, "Round trip serialization works");
+    }
+};
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Unit test for the QoS extension
+ */
+struct QosExtensionTest : public TestCase
+{
+    QosExtensionTest()
+        : TestCase("MADAODV QoS extension")
+    {
+    }
+
+    void DoRun() override
+    {
+        QosExtension h(MilliSeconds(50), DataRate("2Mbps"));
+        NS_TEST_EXPECT_MSG_EQ(h.GetDelayBound(), MilliSeconds(50), "trivial");
+        NS_TEST_EXPECT_MSG_EQ(h.GetBandwidth(), DataRate("2Mbps"), "trivial");
+        h.SetDelayBound(NanoSeconds(10));
+        NS_TEST_EXPECT_MSG_EQ(h.GetDelayBound(),
+                              MicroSeconds(1),
+                              "A positive bound does not vanish");
+        h.SetDelayBound(MilliSeconds(20) + NanoSeconds(10));
+        NS_TEST_EXPECT_MSG_EQ(h.GetDelayBound(), MilliSeconds(20), "Truncated to microseconds");
+        NS_TEST_EXPECT_MSG_EQ(QosExtension().GetBandwidth(), DataRate(0), "No bound");
+
+        Ptr<Packet> p = Create<Packet>();
+        p->AddHeader(h);
+        ExtensionHeader e;
+        p->PeekHeader(e);
+        NS_TEST_EXPECT_MSG_EQ((uint16_t)e.GetType(), MADAODVEXT_QOS, "Extension type");
+        NS_TEST_EXPECT_MSG_EQ((uint16_t)e.GetLength(), 8, "Extension length");
+        QosExtension h2;
+        uint32_t bytes = p->RemoveHeader(h2);
+        NS_TEST_EXPECT_MSG_EQ(bytes, 10, "Extension is 10 bytes long");
+        NS_TEST_EXPECT_MSG_EQ(h, h2, "Round trip serialization works");
+    }
+};
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Unit test for the advertisement extension
+ */
+struct AdvertisementExtensionTest : public TestCase
+{
+    AdvertisementExtensionTest()
+        : TestCase("MADAODV advertisement extension")
+    {
+    }
+
+    void DoRun() override
+    {
+        AdvertisementExtension h(7);
+        NS_TEST_EXPECT_MSG_EQ(h.GetId(), 7, "trivial");
+        h.SetId(h.GetId() + 70000);
+        NS_TEST_EXPECT_MSG_EQ(h.GetId(), 70007, "trivial");
+
+        Ptr<Packet> p = Create<Packet>();
+        p->AddHeader(h);
+        ExtensionHeader e;
+        p->PeekHeader(e);
+        NS_TEST_EXPECT_MSG_EQ((uint16_t)e.GetType(), MADAODVEXT_ADVERTISEMENT, "Extension type");
+        NS_TEST_EXPECT_MSG_EQ((uint16_t)e.GetLength(), 4, "Extension length");
+        AdvertisementExtension h2;
+        uint32_t bytes = p->RemoveHeader(h2);
+        NS_TEST_EXPECT_MSG_EQ(bytes, 6, "Extension is 6 bytes long");
+        NS_TEST_EXPECT_MSG_EQ(h, h2, "Round trip serialization works");
+    }
+};
+
 /**
  * \ingroup madaodv-test
  *
@@ -331,6 +585,33 @@ struct RerrHeaderTest : public TestCase
         uint32_t bytes = p->RemoveHeader(h2);
         NS_TEST_EXPECT_MSG_EQ(bytes, h.GetSerializedSize(), "(De)Serialized size match");
         NS_TEST_EXPECT_MSG_EQ(h, h2, "Round trip serialization works");
+
+        // Destinations are kept sorted whatever the insertion order
+        RerrHeader h3;
+        for (uint32_t k = 255; k > 0; --k)
+        {
+            NS_TEST_EXPECT_MSG_EQ(h3.AddUnDestination(Ipv4Address(0x0a000000 + k), k),
+                                  true,
+                                  "trivial");
+        }
+        NS_TEST_EXPECT_MSG_EQ(h3.GetDestCount(), 255, "Maximum number of destinations");
+        const std::vector<std::pair<Ipv4Address, uint32_t>>& un = h3.GetUnDestinations();
+        for (uint32_t k = 0; k < un.size(); ++k)
+        {
+            NS_TEST_EXPECT_MSG_EQ(un[k].first, Ipv4Address(0x0a000001 + k), "Sorted by address");
+            NS_TEST_EXPECT_MSG_EQ(un[k].second, k + 1, "Sequence number kept");
+        }
+        p = Create<Packet>();
+        p->AddHeader(h3);
+        RerrHeader h4;
+        bytes = p->RemoveHeader(h4);
+        NS_TEST_EXPECT_MSG_EQ(bytes, 3 + 8 * 255, "(De)Serialized size match");
+        NS_TEST_EXPECT_MSG_EQ(h3, h4, "Round trip serialization works");
+
+        std::pair<Ipv4Address, uint32_t> last;
+        NS_TEST_EXPECT_MSG_EQ(h4.RemoveUnDestination(last), true, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(last.first, Ipv4Address("10.0.0.255"), "Highest address removed");
+        NS_TEST_EXPECT_MSG_EQ(h4.GetDestCount(), 254, "trivial");
     }
 };
 
@@ -643,6 +924,74 @@ struct MadaodvRtableEntryTest : public TestCase
     }
 };
 
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Unit test for alternate paths of a MADAODV routing table entry
+ */
+struct MadaodvRtableAlternatePathTest : public TestCase
+{
+    MadaodvRtableAlternatePathTest()
+        : TestCase("RtableEntry alternate paths")
+    {
+    }
+
+    void DoRun() override
+    {
+        Ptr<NetDevice> dev;
+        Ipv4InterfaceAddress iface;
+        RoutingTableEntry rt(/*output device*/ dev,
+                             /*dst*/ Ipv4Address("1.2.3.4"),
+                             /*validSeqNo*/ true,
+                             /*seqNo*/ 10,
+                             /*interface*/ iface,
+                             /*hop*/ 4,
+                             /*next hop*/ Ipv4Address("3.3.3.3"),
+                             /*lifetime*/ Seconds(10));
+        NS_TEST_EXPECT_MSG_EQ(rt.FailOver(), false, "No alternate path");
+        NS_TEST_EXPECT_MSG_EQ(
+            rt.InsertAlternatePath(Ipv4Address("3.3.3.3"), dev, iface, 4, Seconds(10), 3),
+            false,
+            "The next hop of the route is not an alternate path");
+        NS_TEST_EXPECT_MSG_EQ(
+            rt.InsertAlternatePath(Ipv4Address("4.4.4.4"), dev, iface, 5, Seconds(10), 3),
+            false,
+            "A longer path may loop");
+        NS_TEST_EXPECT_MSG_EQ(
+            rt.InsertAlternatePath(Ipv4Address("4.4.4.4"), dev, iface, 4, Seconds(10), 3),
+            true,
+            "trivial");
+        NS_TEST_EXPECT_MSG_EQ(
+            rt.InsertAlternatePath(Ipv4Address("5.5.5.5"), dev, iface, 3, Seconds(10), 3),
+            true,
+            "trivial");
+        NS_TEST_EXPECT_MSG_EQ(
+            rt.InsertAlternatePath(Ipv4Address("6.6.6.6"), dev, iface, 4, Seconds(10), 3),
+            false,
+            "At most MaxPaths paths");
+        NS_TEST_EXPECT_MSG_EQ(rt.GetAlternatePaths().size(), 2, "trivial");
+
+        NS_TEST_EXPECT_MSG_EQ(rt.FailOver(), true, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(rt.GetNextHop(), Ipv4Address("5.5.5.5"), "Shortest path first");
+        NS_TEST_EXPECT_MSG_EQ(rt.GetHop(), 3, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(rt.DeleteAlternatePath(Ipv4Address("4.4.4.4")), true, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(rt.FailOver(), false, "No alternate path left");
+
+        NS_TEST_EXPECT_MSG_EQ(
+            rt.InsertAlternatePath(Ipv4Address("4.4.4.4"), dev, iface, 3, Seconds(10), 3),
+            true,
+            "trivial");
+        rt.SetSeqNo(11);
+        NS_TEST_EXPECT_MSG_EQ(rt.FailOver(), false, "Path learned with an old sequence number");
+        NS_TEST_EXPECT_MSG_EQ(
+            rt.InsertAlternatePath(Ipv4Address("4.4.4.4"), dev, iface, 3, Seconds(10), 3),
+            true,
+            "trivial");
+        rt.Invalidate(Seconds(1));
+        NS_TEST_EXPECT_MSG_EQ(rt.GetAlternatePaths().empty(), true, "Invalid route has no paths");
+    }
+};
+
 /**
  * \ingroup madaodv-test
  *
@@ -730,6 +1079,163 @@ struct MadaodvRtableTest : public TestCase
     }
 };
 
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Unit test for the route state notifications of the routing table
+ */
+struct MadaodvRtableRouteStateTest : public TestCase
+{
+    MadaodvRtableRouteStateTest()
+        : TestCase("RtableRouteState"),
+          m_valid(0),
+          m_invalid(0)
+    {
+    }
+
+    /**
+     * Route state change callback
+     * \param dst the destination address
+     * \param valid whether the route is valid
+     */
+    void RouteState(Ipv4Address dst, bool valid)
+    {
+        m_last = dst;
+        valid ? m_valid++ : m_invalid++;
+    }
+
+    void DoRun() override
+    {
+        RoutingTable rtable(Seconds(2));
+        rtable.SetRouteStateCallback(
+            MakeCallback(&MadaodvRtableRouteStateTest::RouteState, this));
+        Ptr<NetDevice> dev;
+        Ipv4InterfaceAddress iface;
+        RoutingTableEntry rt(/*output device*/ dev,
+                             /*dst*/ Ipv4Address("1.2.3.4"),
+                             /*validSeqNo*/ true,
+                             /*seqNo*/ 10,
+                             /*interface*/ iface,
+                             /*hop*/ 5,
+                             /*next hop*/ Ipv4Address("1.1.1.1"),
+                             /*lifetime*/ Seconds(10));
+        rt.SetFlag(IN_SEARCH);
+        rtable.AddRoute(rt);
+        NS_TEST_EXPECT_MSG_EQ(m_valid + m_invalid, 0, "A route being searched is not valid");
+        rt.SetFlag(VALID);
+        rtable.Update(rt);
+        NS_TEST_EXPECT_MSG_EQ(m_valid, 1, "The route became valid");
+        NS_TEST_EXPECT_MSG_EQ(m_last, Ipv4Address("1.2.3.4"), "trivial");
+        rt.SetHop(3);
+        rtable.Update(rt);
+        NS_TEST_EXPECT_MSG_EQ(m_valid, 1, "The route stays valid");
+        std::map<Ipv4Address, uint32_t> unreachable;
+        unreachable.insert(std::make_pair(Ipv4Address("1.2.3.4"), 11));
+        rtable.InvalidateRoutesWithDst(unreachable);
+        NS_TEST_EXPECT_MSG_EQ(m_invalid, 1, "The route was invalidated");
+        rtable.DeleteRoute(Ipv4Address("1.2.3.4"));
+        NS_TEST_EXPECT_MSG_EQ(m_invalid, 1, "The route was already invalid");
+        Simulator::Destroy();
+    }
+
+    Ipv4Address m_last; ///< destination of the last notification
+    uint32_t m_valid;   ///< number of routes which became valid
+    uint32_t m_invalid; ///< number of routes which stopped being valid
+};
+
+/**
+ * \ingroup madaodv-test
+ *
+ * \brief Unit test for the longest prefix match of subnet routes
+ */
+struct MadaodvRtableLongestPrefixTest : public TestCase
+{
+    MadaodvRtableLongestPrefixTest()
+        : TestCase("RtableLongestPrefix")
+    {
+    }
+
+    void DoRun() override
+    {
+        RoutingTable rtable(Seconds(2));
+        Ptr<NetDevice> dev;
+        Ipv4InterfaceAddress iface;
+        RoutingTableEntry rt;
+        RoutingTableEntry wide(/*output device*/ dev,
+                               /*dst*/ Ipv4Address("10.2.3.4"),
+                               /*validSeqNo*/ true,
+                               /*seqNo*/ 10,
+                               /*interface*/ iface,
+                               /*hop*/ 5,
+                               /*next hop*/ Ipv4Address("1.1.1.1"),
+                               /*lifetime*/ Seconds(10));
+        NS_TEST_EXPECT_MSG_EQ(wide.GetPrefixMask(), Ipv4Mask::GetOnes(), "A host route");
+        wide.SetPrefixSize(16);
+        NS_TEST_EXPECT_MSG_EQ(wide.GetDestination(), Ipv4Address("10.2.0.0"), "Subnet address");
+        NS_TEST_EXPECT_MSG_EQ(wide.GetPrefixMask(), Ipv4Mask("255.255.0.0"), "trivial");
+        NS_TEST_EXPECT_MSG_EQ(rtable.LookupLongestPrefixRoute(Ipv4Address("10.2.3.4"), rt),
+                              false,
+                              "No route yet");
+        NS_TEST_EXPECT_MSG_EQ(rtable.AddRoute(wide), true, "trivial");
+        NS_TEST_EXPECT_MSG_EQ(rtable.LookupLongestPrefixRoute(Ipv4Address("10.2.3.4"), rt),
+                              true,
+                              "The subnet route matches");
+        NS_TEST_EXPECT_MSG_EQ(rt.GetNextHop(), Ipv4Address("1.1.1.1"), "trivial");
+        NS_TEST_EXPECT_MSG_EQ(rtable.LookupLongestPrefixRoute(Ipv4Address("10.3.3.4"), rt),
+                              false,
+                              "Outside of the subnet");
+
+        RoutingTableEntry narrow(/*output device*/ dev,
+                                 /*dst*/ Ipv4Address("10.2.3.0"),
+                                 /*validSeqNo*/ true,
+                                 /*seqNo*/ 3,
+                                 /*interface*/ iface,
+                                 /*hop*/ 2,
+                                 /*next hop*/ Ipv4Address("2.2.2.2"),
+                                 /*lifetime*/ Seconds(10));
+        narrow.SetPrefixSize(24);
+        rtable.AddRoute(narrow);
+        NS_TEST_EXPECT_MSG_EQ(rtable.LookupLongestPrefixRoute(Ipv4Address("10.2.3.4"), rt),
+                              true,
+                              "trivial");
+        NS_TEST_EXPECT_MSG_EQ(rt.GetNextHop(), Ipv4Address("2.2.2.2"), "The longest prefix wins");
+        NS_TEST_EXPECT_MSG_EQ(rtable.LookupLongestPrefixRoute(Ipv4Address("10.2.4.4"), rt),
+                              true,
+                              "trivial");
+        NS_TEST_EXPECT_MSG_EQ(rt.GetNextHop(), Ipv4Address("1.1.1.1"), "Only the wide one matches");
+
+        RoutingTableEntry host(/*output device*/ dev,
+                               /*dst*/ Ipv4Address("10.2.3.4"),
+                               /*validSeqNo*/ true,
+                               /*seqNo*/ 7,
+                               /*interface*/ iface,
+                               /*hop*/ 1,
+                               /*next hop*/ Ipv4Address("3.3.3.3"),
+                               /*lifetime*/ Seconds(10));
+        host.SetFlag(IN_SEARCH);
+        rtable.AddRoute(host);
+        NS_TEST_EXPECT_MSG_EQ(rtable.LookupLongestPrefixRoute(Ipv4Address("10.2.3.4"), rt),
+                              true,
+                              "trivial");
+        NS_TEST_EXPECT_MSG_EQ(rt.GetNextHop(),
+                              Ipv4Address("2.2.2.2"),
+                              "A host route being searched does not hide the subnet");
+        std::vector<Ipv4Address> searched;
+        rtable.GetInSearchDestinations(narrow.GetDestination(), narrow.GetPrefixMask(), searched);
+        NS_TEST_EXPECT_MSG_EQ(searched.size(), 1, "The host being searched is in the subnet");
+        NS_TEST_EXPECT_MSG_EQ(searched.front(), Ipv4Address("10.2.3.4"), "trivial");
+        rtable.GetInSearchDestinations(Ipv4Address("10.3.0.0"), Ipv4Mask("255.255.0.0"), searched);
+        NS_TEST_EXPECT_MSG_EQ(searched.empty(), true, "Outside of the subnet");
+        host.SetFlag(VALID);
+        rtable.Update(host);
+        NS_TEST_EXPECT_MSG_EQ(rtable.LookupLongestPrefixRoute(Ipv4Address("10.2.3.4"), rt),
+                              true,
+                              "trivial");
+        NS_TEST_EXPECT_MSG_EQ(rt.GetNextHop(), Ipv4Address("3.3.3.3"), "The host route wins");
+        Simulator::Destroy();
+    }
+};
+
 /**
  * \ingroup madaodv-test
  *
@@ -746,11 +1252,20 @@ class MadaodvTestSuite : public TestSuite
         AddTestCase(new RreqHeaderTest, TestCase::QUICK);
         AddTestCase(new RrepHeaderTest, TestCase::QUICK);
         AddTestCase(new RrepAckHeaderTest, TestCase::QUICK);
+        AddTestCase(new NeighborSetExtensionTest, TestCase::QUICK);
+        AddTestCase(new MultiDestinationExtensionTest, TestCase::QUICK);
+        AddTestCase(new PathExtensionTest, TestCase::QUICK);
+        AddTestCase(new LoadExtensionTest, TestCase::QUICK);
+        AddTestCase(new QosExtensionTest, TestCase::QUICK);
+        AddTestCase(new AdvertisementExtensionTest, TestCase::QUICK);
         AddTestCase(new RerrHeaderTest, TestCase::QUICK);
         AddTestCase(new QueueEntryTest, TestCase::QUICK);
         AddTestCase(new MadaodvRqueueTest, TestCase::QUICK);
         AddTestCase(new MadaodvRtableEntryTest, TestCase::QUICK);
+        AddTestCase(new MadaodvRtableAlternatePathTest, TestCase::QUICK);
         AddTestCase(new MadaodvRtableTest, TestCase::QUICK);
+        AddTestCase(new MadaodvRtableRouteStateTest, TestCase::QUICK);
+        AddTestCase(new MadaodvRtableLongestPrefixTest, TestCase::QUICK);
     }
 } g_madaodvTestSuite; ///< the test suite
 